@@ -0,0 +1,169 @@
+//
+// Board.h
+// Copyright (C) 2018 Marius Greuel. All rights reserved.
+//
+
+#pragma once
+#include <avr/io.h>
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Each board has a traits struct with its pins and timer, which the code uses through
+// the Board typedef. The HIDRCJOY_* switches add or remove code and data members, so
+// they stay macros. This file is also included by the C and assembler sources of the
+// USB stack, which only see the macros.
+//
+// HIDRCJOY_SRXL: SRXL receiver on the USART
+// HIDRCJOY_TIMER1: system clock and input capture on the 16-bit timer1, else timer0 and the USI
+// HIDRCJOY_CAPTURE_COMPARATOR: input capture from the analog comparator instead of the ICP pin
+// HIDRCJOY_OSCCAL: RC oscillator calibrated against the USB frame timing
+// HIDRCJOY_UPSAMPLING: channel values extrapolated between frames
+// HIDRCJOY_SLEEP: main loop sleeps between interrupts
+// HIDRCJOY_CURVES: per-channel expo, rate, custom curves and deadband, else linear axes
+// HIDRCJOY_FILTERS: per-channel median and adaptive filter, required by HIDRCJOY_UPSAMPLING
+// HIDRCJOY_MIXER: channel mixer, which needs more RAM and flash than the smaller boards have to spare
+// HIDRCJOY_PROFILES: number of configuration profiles, each a complete configuration with its gains
+// USB_CFG_*, USB_INTR_*: wiring of the USB lines for V-USB, see usbconfig.h
+
+#if defined (BOARD_Digispark)
+#define HIDRCJOY_SRXL 0
+#define HIDRCJOY_TIMER1 0
+#define HIDRCJOY_CAPTURE_COMPARATOR 0
+#define HIDRCJOY_OSCCAL 1
+#define HIDRCJOY_UPSAMPLING 0
+#define HIDRCJOY_SLEEP 0
+#define HIDRCJOY_CURVES 0
+#define HIDRCJOY_FILTERS 0
+#define HIDRCJOY_MIXER 0
+#define HIDRCJOY_PROFILES 1
+
+#define USB_CFG_IOPORTNAME      B
+#define USB_CFG_DMINUS_BIT      3
+#define USB_CFG_DPLUS_BIT       4
+#define USB_INTR_CFG            PCMSK
+#define USB_INTR_CFG_SET        (1 << USB_CFG_DPLUS_BIT)
+#define USB_INTR_CFG_CLR        0
+#define USB_INTR_ENABLE         GIMSK
+#define USB_INTR_ENABLE_BIT     PCIE
+#define USB_INTR_PENDING        GIFR
+#define USB_INTR_PENDING_BIT    PCIF
+#define USB_INTR_VECTOR         PCINT0_vect
+
+#ifdef __cplusplus
+struct DigisparkBoard
+{
+    static const uint8_t timerPrescaler = 64;
+    static const uint8_t ppmSignal = 2; // Pin 2
+    static const uint8_t ledStatus = 1; // Pin 1 (built-in LED)
+
+    static volatile uint8_t& PpmSignalPin() { return PINB; }
+    static volatile uint8_t& PpmSignalPort() { return PORTB; }
+    static volatile uint8_t& LedStatusDdr() { return DDRB; }
+    static volatile uint8_t& LedStatusPort() { return PORTB; }
+};
+
+typedef DigisparkBoard Board;
+#endif
+#elif defined (BOARD_DigisparkPro)
+#define HIDRCJOY_SRXL 0
+#define HIDRCJOY_TIMER1 1
+#define HIDRCJOY_CAPTURE_COMPARATOR 0
+#define HIDRCJOY_OSCCAL 0
+#define HIDRCJOY_UPSAMPLING 0
+#define HIDRCJOY_SLEEP 0
+#define HIDRCJOY_CURVES 0
+#define HIDRCJOY_FILTERS 0
+#define HIDRCJOY_MIXER 0
+#define HIDRCJOY_PROFILES 1
+
+#define USB_CFG_IOPORTNAME      B
+#define USB_CFG_DMINUS_BIT      3
+#define USB_CFG_DPLUS_BIT       6
+#define USB_INTR_CFG            PCMSK1
+#define USB_INTR_CFG_SET        (1 << USB_CFG_DPLUS_BIT)
+#define USB_INTR_CFG_CLR        0
+#define USB_INTR_ENABLE         PCICR
+#define USB_INTR_ENABLE_BIT     PCIE1
+#define USB_INTR_PENDING        PCIFR
+#define USB_INTR_PENDING_BIT    PCIF1
+#define USB_INTR_VECTOR         PCINT1_vect
+
+#ifdef __cplusplus
+struct DigisparkProBoard
+{
+    static const uint8_t timerPrescaler = 8;
+    static const uint8_t ppmSignal = 4;
+    static const uint8_t ledStatus = 1; // Pin 1 (built-in LED)
+
+    static volatile uint8_t& PpmSignalPin() { return PINA; }
+    static volatile uint8_t& PpmSignalPort() { return PORTA; }
+    static volatile uint8_t& LedStatusDdr() { return DDRB; }
+    static volatile uint8_t& LedStatusPort() { return PORTB; }
+};
+
+typedef DigisparkProBoard Board;
+#endif
+#elif defined (BOARD_FabISP)
+#define HIDRCJOY_SRXL 0
+#define HIDRCJOY_TIMER1 1
+#define HIDRCJOY_CAPTURE_COMPARATOR 1 // the ICP pin is tied up for USB
+#define HIDRCJOY_OSCCAL 0
+#define HIDRCJOY_UPSAMPLING 0
+#define HIDRCJOY_SLEEP 0
+#define HIDRCJOY_CURVES 0
+#define HIDRCJOY_FILTERS 0
+#define HIDRCJOY_MIXER 0
+#define HIDRCJOY_PROFILES 1
+
+#define USB_CFG_IOPORTNAME      A
+#define USB_CFG_DMINUS_BIT      0
+#define USB_CFG_DPLUS_BIT       7
+
+#ifdef __cplusplus
+struct FabIspBoard
+{
+    static const uint8_t timerPrescaler = 8;
+    static const uint8_t ppmSignal = 6; // ADC6/MOSI
+    static const uint8_t ledStatus = 5; // PA5/MISO
+
+    static volatile uint8_t& PpmSignalPin() { return PINA; }
+    static volatile uint8_t& PpmSignalPort() { return PORTA; }
+    static volatile uint8_t& LedStatusDdr() { return DDRA; }
+    static volatile uint8_t& LedStatusPort() { return PORTA; }
+};
+
+typedef FabIspBoard Board;
+#endif
+#elif defined (BOARD_ProMicro)
+#define HIDRCJOY_SRXL 1
+#define HIDRCJOY_TIMER1 1
+#define HIDRCJOY_CAPTURE_COMPARATOR 0
+#define HIDRCJOY_OSCCAL 0
+#define HIDRCJOY_UPSAMPLING 1
+#define HIDRCJOY_SLEEP 1
+#define HIDRCJOY_CURVES 1
+#define HIDRCJOY_FILTERS 1
+#define HIDRCJOY_MIXER 1
+#define HIDRCJOY_PROFILES 3
+
+#ifdef __cplusplus
+struct ProMicroBoard
+{
+    static const uint8_t timerPrescaler = 8;
+    static const uint8_t ppmSignal = 4; // Pin 4
+    static const uint8_t ledStatus = 0; // Pin 17 (built-in Rx LED)
+
+    static volatile uint8_t& PpmSignalPin() { return PIND; }
+    static volatile uint8_t& PpmSignalPort() { return PORTD; }
+    static volatile uint8_t& LedStatusDdr() { return DDRB; }
+    static volatile uint8_t& LedStatusPort() { return PORTB; }
+};
+
+typedef ProMicroBoard Board;
+#endif
+#else
+#error Unsupported board
+#endif
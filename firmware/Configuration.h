@@ -4,35 +4,153 @@
 //
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 /////////////////////////////////////////////////////////////////////////////
 
 #define MAX_CHANNELS 7
+#define MAX_CURVES 2
+#define CURVE_POINTS 9
+
+// The firmware takes its feature switches from the board, the tool knows all features
+#if defined(__AVR__)
+#include "Board.h"
+#else
+#define HIDRCJOY_SRXL 1
+#define HIDRCJOY_CURVES 1
+#define HIDRCJOY_FILTERS 1
+#define HIDRCJOY_MIXER 1
+#define HIDRCJOY_PROFILES 1
+#endif
+
+// The configuration is exchanged as a byte array, so use the AVR layout in the tool
+#pragma pack(push, 1)
+
+// Pulse widths in us of a channel, learned from the transmitter endpoints
+struct ChannelCalibration
+{
+    uint16_t m_minPulseWidth;
+    uint16_t m_centerPulseWidth;
+    uint16_t m_maxPulseWidth;
+};
+
+// Response curve of a channel, applied after centering
+struct ChannelCurve
+{
+    uint8_t m_expo; // 0..100%, blends the linear response with a cubic one
+    uint8_t m_rate; // 0..100%, scales the output
+    uint8_t m_curve; // 0 for expo, or 1..MAX_CURVES to select a custom curve
+    uint8_t m_deadband; // 0..maxDeadband, in 1/256 of the half range around center
+};
+
+// Adaptive low-pass filter of a channel, which smoothes more the slower the channel moves.
+// The weight of a new sample is m_minAlpha + m_beta * |sample - filtered value| in us.
+struct ChannelFilter
+{
+    uint8_t m_minAlpha; // 1..255 in 1/256, weight of a new sample at rest, 0 disables the filter
+    uint8_t m_beta; // in 1/256 per us
+};
 
 struct Configuration
 {
 #ifdef __cplusplus
-    static const uint8_t version = 0x11;
+    static const uint8_t version = 0x18;
     static const uint8_t maxChannels = MAX_CHANNELS;
     static const uint16_t minSyncWidth = 2000;
     static const uint16_t maxSyncWidth = 10000;
     static const uint16_t minChannelPulseWidth = 500;
     static const uint16_t maxChannelPulseWidth = 3000;
+    static const uint16_t minCalibrationRange = 64;
+    static const uint8_t maxCurves = MAX_CURVES;
+    static const uint8_t curvePoints = CURVE_POINTS;
+    static const uint8_t maxDeadband = 128;
 
     enum Flags
     {
         InvertedSignal = 1,
+        TimingReports = 2,
+        Upsampling = 4,
     };
+
+    // Returns the number of leading bytes of a configuration stored at the start of the EEPROM
+    // by a firmware before the journal, which are laid out as in this version, or 0 if the
+    // version is unknown. Only version 0x11 was stored there, any other version is the start
+    // of a journal slot.
+    static uint8_t GetCompatibleSize(uint8_t version)
+    {
+        switch (version)
+        {
+        case 0x11:
+            return offsetof(Configuration, m_twoPositionSwitches);
+        default:
+            return 0;
+        }
+    }
+
+    // Returns the number of positions of a switch channel, or 0 if the channel is an axis
+    uint8_t GetSwitchPositions(uint8_t channel) const
+    {
+        if ((m_threePositionSwitches & (1 << channel)) != 0)
+            return 3;
+        else if ((m_twoPositionSwitches & (1 << channel)) != 0)
+            return 2;
+        else
+            return 0;
+    }
 #endif
 
     uint8_t m_reportId;
     uint8_t m_version;
     uint8_t m_flags;
-    uint8_t m_dummy;
+    uint8_t m_reportLayout;
     uint16_t m_minSyncPulseWidth;
     uint16_t m_centerChannelPulseWidth;
     uint16_t m_channelPulseWidthRange;
     uint8_t m_polarity;
     uint8_t m_mapping[MAX_CHANNELS];
+    uint8_t m_twoPositionSwitches;
+    uint8_t m_threePositionSwitches;
+    uint8_t m_calibratedChannels; // channels using m_calibration instead of the center and range above
+    struct ChannelCalibration m_calibration[MAX_CHANNELS];
+    // The fields below only exist on boards with the feature, the tool only uses the fields above
+#if HIDRCJOY_CURVES
+    struct ChannelCurve m_curves[MAX_CHANNELS];
+    int8_t m_customCurves[MAX_CURVES][CURVE_POINTS]; // -127..127 at equidistant inputs
+#endif
+#if HIDRCJOY_FILTERS
+    struct ChannelFilter m_filters[MAX_CHANNELS];
+    uint8_t m_medianChannels; // channels with median-of-three glitch rejection
+#endif
+#if HIDRCJOY_SRXL
+    uint8_t m_srxlChannels; // channels preferring SRXL over PPM, if both are received
+#endif
+};
+
+// Mixes the channels into the axes, axis[i] = sum(m_matrix[i][j] * channel[j])
+struct MixerConfiguration
+{
+#ifdef __cplusplus
+    static const int16_t unity = 0x100; // Q8.8
+    static const int16_t maxCoefficient = 16 * unity;
+#endif
+
+    uint8_t m_reportId;
+    uint8_t m_enabled;
+    int16_t m_matrix[MAX_CHANNELS][MAX_CHANNELS];
 };
+
+// Selects the active profile, shared by all profiles
+struct ProfileConfiguration
+{
+#ifdef __cplusplus
+    static const uint8_t noSelectChannel = 0xFF;
+#endif
+
+    uint8_t m_reportId;
+    uint8_t m_profileCount; // number of profiles of the device, read-only
+    uint8_t m_activeProfile;
+    uint8_t m_selectChannel; // channel selecting the profile by its position, or noSelectChannel
+};
+
+#pragma pack(pop)
@@ -3,23 +3,24 @@
 // Copyright(C) 2018 Marius Greuel.All rights reserved.
 //
 
+#include <string.h>
 #include <avr/pgmspace.h>
 #include "UsbReports.h"
 #include "Descriptors.h"
 
 /////////////////////////////////////////////////////////////////////////////
+// Report descriptor sections, shared by V-USB and LUFA
 
-#if defined(USB_V_USB)
-
-#include "usbdrv/usbdrv.h"
-#include "usbconfig.h"
-
-const uint8_t usbHidReportDescriptor[] PROGMEM =
+static const uint8_t JoystickReportHeader[] PROGMEM =
 {
     0x05, 0x01,         // USAGE_PAGE (Generic Desktop)
     0x09, 0x04,         // USAGE (Joystick)
     0xA1, 0x01,         // COLLECTION (Application)
     0x09, 0x01,         //   USAGE (Pointer)
+};
+
+static const uint8_t Axes7Report[] PROGMEM =
+{
     0x85, UsbReportId,  //   REPORT_ID (UsbReportId)
     0x75, 0x08,         //   REPORT_SIZE (8)
     0x15, 0x00,         //   LOGICAL_MINIMUM (0)
@@ -45,8 +46,126 @@ const uint8_t usbHidReportDescriptor[] PROGMEM =
     0x95, 0x03,         //     REPORT_COUNT (3)
     0x81, 0x02,         //     INPUT (Data,Var,Abs)
     0xC0,               //   END_COLLECTION
-    0xA1, 0x02,         //   COLLECTION (Logical)
+};
+
+static const uint8_t Axes4Report[] PROGMEM =
+{
+    0x85, UsbReport4Id, //   REPORT_ID (UsbReport4Id)
+    0x75, 0x08,         //   REPORT_SIZE (8)
+    0x15, 0x00,         //   LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,   //   LOGICAL_MAXIMUM (255)
+    0x35, 0x00,         //   PHYSICAL_MINIMUM (0)
+    0x46, 0xFF, 0x00,   //   PHYSICAL_MAXIMUM (255)
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x30,         //     USAGE (X)
+    0x09, 0x31,         //     USAGE (Y)
+    0x95, 0x02,         //     REPORT_COUNT (2)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x32,         //     USAGE (Z)
+    0x09, 0x33,         //     USAGE (Rx)
+    0x95, 0x02,         //     REPORT_COUNT (2)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+};
+
+static const uint8_t Axes16Report[] PROGMEM =
+{
+#if defined(USB_V_USB)
+    0x75, 0x10,         //   REPORT_SIZE (16)
+    0x16, 0x01, 0x80,   //   LOGICAL_MINIMUM (-32767)
+    0x26, 0xFF, 0x7F,   //   LOGICAL_MAXIMUM (32767)
+    0x36, 0x01, 0x80,   //   PHYSICAL_MINIMUM (-32767)
+    0x46, 0xFF, 0x7F,   //   PHYSICAL_MAXIMUM (32767)
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x85, UsbReport16Part1Id, // REPORT_ID (UsbReport16Part1Id)
+    0x09, 0x30,         //     USAGE (X)
+    0x09, 0x31,         //     USAGE (Y)
+    0x09, 0x32,         //     USAGE (Z)
+    0x95, 0x03,         //     REPORT_COUNT (3)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x85, UsbReport16Part2Id, // REPORT_ID (UsbReport16Part2Id)
+    0x09, 0x33,         //     USAGE (Rx)
+    0x09, 0x34,         //     USAGE (Ry)
+    0x09, 0x35,         //     USAGE (Rz)
+    0x95, 0x03,         //     REPORT_COUNT (3)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x85, UsbReport16Part3Id, // REPORT_ID (UsbReport16Part3Id)
+    0x09, 0x36,         //     USAGE (Slider)
+    0x95, 0x01,         //     REPORT_COUNT (1)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0x95, 0x02,         //     REPORT_COUNT (2)
+    0x81, 0x03,         //     INPUT (Cnst,Var,Abs)
+    0xC0,               //   END_COLLECTION
+#else
+    0x85, UsbReport16Id, //  REPORT_ID (UsbReport16Id)
+    0x75, 0x10,         //   REPORT_SIZE (16)
+    0x16, 0x01, 0x80,   //   LOGICAL_MINIMUM (-32767)
+    0x26, 0xFF, 0x7F,   //   LOGICAL_MAXIMUM (32767)
+    0x36, 0x01, 0x80,   //   PHYSICAL_MINIMUM (-32767)
+    0x46, 0xFF, 0x7F,   //   PHYSICAL_MAXIMUM (32767)
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x30,         //     USAGE (X)
+    0x09, 0x31,         //     USAGE (Y)
+    0x95, 0x02,         //     REPORT_COUNT (2)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x32,         //     USAGE (Z)
+    0x09, 0x33,         //     USAGE (Rx)
+    0x95, 0x02,         //     REPORT_COUNT (2)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x34,         //     USAGE (Ry)
+    0x09, 0x35,         //     USAGE (Rz)
+    0x09, 0x36,         //     USAGE (Slider)
+    0x95, 0x03,         //     REPORT_COUNT (3)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+#endif
+};
+
+static const uint8_t ButtonsReport[] PROGMEM =
+{
+    0x85, UsbButtonReportId, // REPORT_ID (UsbButtonReportId)
+    0x75, 0x08,         //   REPORT_SIZE (8)
+    0x15, 0x00,         //   LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,   //   LOGICAL_MAXIMUM (255)
+    0x35, 0x00,         //   PHYSICAL_MINIMUM (0)
+    0x46, 0xFF, 0x00,   //   PHYSICAL_MAXIMUM (255)
+    0xA1, 0x00,         //   COLLECTION (Physical)
+    0x09, 0x30,         //     USAGE (X)
+    0x09, 0x31,         //     USAGE (Y)
+    0x09, 0x32,         //     USAGE (Z)
+    0x09, 0x33,         //     USAGE (Rx)
+    0x09, 0x34,         //     USAGE (Ry)
+    0x95, 0x05,         //     REPORT_COUNT (5)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0xC0,               //   END_COLLECTION
+    0x05, 0x09,         //   USAGE_PAGE (Button)
+    0x19, 0x01,         //   USAGE_MINIMUM (Button 1)
+    0x29, 0x10,         //   USAGE_MAXIMUM (Button 16)
+    0x25, 0x01,         //   LOGICAL_MAXIMUM (1)
+    0x45, 0x01,         //   PHYSICAL_MAXIMUM (1)
+    0x75, 0x01,         //   REPORT_SIZE (1)
+    0x95, 0x10,         //   REPORT_COUNT (16)
+    0x81, 0x02,         //   INPUT (Data,Var,Abs)
+};
+
+static const uint8_t VendorReportItems[] PROGMEM =
+{
     0x06, 0x00, 0xFF,   //     USAGE_PAGE (Vendor Defined Page 1)
+    0x75, 0x08,         //     REPORT_SIZE (8)
+    0x15, 0x00,         //     LOGICAL_MINIMUM (0)
+    0x26, 0xFF, 0x00,   //     LOGICAL_MAXIMUM (255)
+    0x35, 0x00,         //     PHYSICAL_MINIMUM (0)
+    0x46, 0xFF, 0x00,   //     PHYSICAL_MAXIMUM (255)
     0x85, UsbEnhancedReportId, // REPORT_ID (UsbEnhancedReportId)
     0x95, sizeof(struct UsbEnhancedReport), // REPORT_COUNT (...)
     0x09, 0x00,         //     USAGE (...)
@@ -71,11 +190,244 @@ const uint8_t usbHidReportDescriptor[] PROGMEM =
     0x95, 0x01,         //     REPORT_COUNT (1)
     0x09, JumpToBootloaderId, // USAGE (...)
     0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
-    0xC0,               //   END_COLLECTION
-    0xC0,               // END COLLECTION
+    0x85, UsbTimingReportId, // REPORT_ID (...)
+    0x95, sizeof(struct UsbTimingReport) - 1, // REPORT_COUNT (...)
+    0x09, UsbTimingReportId, // USAGE (...)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0x85, UsbDiagnosticsPart1Id, // REPORT_ID (...)
+    0x95, sizeof(struct UsbDiagnosticsReport) - 1, // REPORT_COUNT (...)
+    0x09, UsbDiagnosticsPart1Id, // USAGE (...)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0x85, UsbDiagnosticsPart2Id, // REPORT_ID (...)
+    0x95, sizeof(struct UsbDiagnosticsReport) - 1, // REPORT_COUNT (...)
+    0x09, UsbDiagnosticsPart2Id, // USAGE (...)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0x85, UsbDiagnosticsPart3Id, // REPORT_ID (...)
+    0x95, sizeof(struct UsbDiagnosticsReport) - 1, // REPORT_COUNT (...)
+    0x09, UsbDiagnosticsPart3Id, // USAGE (...)
+    0x81, 0x02,         //     INPUT (Data,Var,Abs)
+    0x85, DiagnosticsControlId, // REPORT_ID (...)
+    0x95, sizeof(struct UsbDiagnosticsControlReport) - 1, // REPORT_COUNT (...)
+    0x09, DiagnosticsControlId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+    0x85, CalibrationControlId, // REPORT_ID (...)
+    0x95, sizeof(struct UsbCalibrationControlReport) - 1, // REPORT_COUNT (...)
+    0x09, CalibrationControlId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+    0x85, EepromStatusId, // REPORT_ID (...)
+    0x95, sizeof(struct UsbEepromStatusReport) - 1, // REPORT_COUNT (...)
+    0x09, EepromStatusId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+    0x85, ConfigurationPatchId, // REPORT_ID (...)
+    0x95, sizeof(struct UsbConfigurationPatchReport) - 1, // REPORT_COUNT (...)
+    0x09, ConfigurationPatchId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+#if HIDRCJOY_PROFILES > 1
+    0x85, ProfileReportId, // REPORT_ID (...)
+    0x95, sizeof(struct ProfileConfiguration) - 1, // REPORT_COUNT (...)
+    0x09, ProfileReportId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+#endif
+#if HIDRCJOY_MIXER
+    0x85, MixerReportId, // REPORT_ID (...)
+    0x95, sizeof(struct MixerConfiguration) - 1, // REPORT_COUNT (...)
+    0x09, MixerReportId, // USAGE (...)
+    0xB1, 0x02,         //     FEATURE (Data,Var,Abs)
+#endif
+};
+
+static const uint8_t EndCollection[] PROGMEM =
+{
+    0xC0,               // END_COLLECTION
 };
 
-_Static_assert(sizeof(usbHidReportDescriptor) == USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH, "USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH size mismatch");
+// The report layouts selectable with Configuration::m_reportLayout
+const struct ReportLayout g_ReportLayouts[ReportLayoutCount] PROGMEM =
+{
+    [Axes7Layout] = { Axes7Report, sizeof(Axes7Report), UsbReportId, 1, sizeof(struct UsbReport) },
+    [Axes4Layout] = { Axes4Report, sizeof(Axes4Report), UsbReport4Id, 1, sizeof(struct UsbReport4) },
+#if defined(USB_V_USB)
+    [Axes16Layout] = { Axes16Report, sizeof(Axes16Report), UsbReport16Part1Id, USB_REPORT16_PARTS, sizeof(struct UsbReport16Part) },
+#else
+    [Axes16Layout] = { Axes16Report, sizeof(Axes16Report), UsbReport16Id, 1, sizeof(struct UsbReport16) },
+#endif
+    [ButtonsLayout] = { ButtonsReport, sizeof(ButtonsReport), UsbButtonReportId, 1, sizeof(struct UsbButtonReport) },
+};
+
+static struct ReportLayout g_ActiveLayout;
+
+struct DescriptorSection
+{
+    const uint8_t* m_data;
+    uint8_t m_length;
+};
+
+// Copies up to 'length' bytes at 'offset' of the concatenated sections
+static uint8_t CopySections(uint8_t* data, uint16_t offset, uint8_t length, const struct DescriptorSection* sections, uint8_t count)
+{
+    uint8_t copied = 0;
+
+    for (uint8_t i = 0; i < count && copied < length; i++)
+    {
+        if (offset >= sections[i].m_length)
+        {
+            offset -= sections[i].m_length;
+            continue;
+        }
+
+        uint8_t size = sections[i].m_length - offset;
+        if (size > length - copied)
+        {
+            size = length - copied;
+        }
+
+        memcpy_P(data + copied, sections[i].m_data + offset, size);
+        copied += size;
+        offset = 0;
+    }
+
+    return copied;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(USB_V_USB)
+
+#include "usbdrv/usbdrv.h"
+#include "usbconfig.h"
+
+// The configuration, HID and report descriptors are served by usbFunctionDescriptor()
+// and usbFunctionRead(), because the report descriptor length depends on the layout.
+PROGMEM const uchar usbDescriptorConfiguration[] =
+{
+    9,                  // sizeof(usbDescriptorConfiguration)
+    USBDESCR_CONFIG,
+    9 + 9 + 9 + 7, 0,   // total length
+    1,                  // number of interfaces
+    1,                  // index of this configuration
+    0,                  // configuration name string index
+    (1 << 7) | USBATTR_REMOTEWAKE,
+    USB_CFG_MAX_BUS_POWER / 2,
+    9,                  // sizeof(usbDescrInterface)
+    USBDESCR_INTERFACE,
+    0,                  // index of this interface
+    0,                  // alternate setting
+    1,                  // number of endpoints
+    USB_CFG_INTERFACE_CLASS,
+    USB_CFG_INTERFACE_SUBCLASS,
+    USB_CFG_INTERFACE_PROTOCOL,
+    0,                  // interface string index
+    9,                  // sizeof(usbDescrHID)
+    USBDESCR_HID,
+    0x01, 0x01,         // HID version
+    0x00,               // country code
+    0x01,               // number of report descriptors
+    USBDESCR_HID_REPORT,
+    0, 0,               // report descriptor length, inserted at runtime
+    7,                  // sizeof(usbDescrEndpoint)
+    USBDESCR_ENDPOINT,
+    0x81,               // IN endpoint 1
+    0x03,               // interrupt endpoint
+    8, 0,               // maximum packet size
+    USB_CFG_INTR_POLL_INTERVAL,
+};
+
+#define HID_DESCRIPTOR_OFFSET 18
+#define HID_DESCRIPTOR_LENGTH 9
+#define HID_REPORT_LENGTH_OFFSET (HID_DESCRIPTOR_OFFSET + 7)
+
+static const uint8_t VendorCollection[] PROGMEM =
+{
+    0xA1, 0x02,         //   COLLECTION (Logical)
+};
+
+static uint8_t g_DescriptorType;
+static uint8_t g_DescriptorPosition;
+
+static uint8_t GetReportDescriptorSections(struct DescriptorSection* sections)
+{
+    sections[0] = (struct DescriptorSection){ JoystickReportHeader, sizeof(JoystickReportHeader) };
+    sections[1] = (struct DescriptorSection){ g_ActiveLayout.m_descriptor, g_ActiveLayout.m_descriptorLength };
+    sections[2] = (struct DescriptorSection){ VendorCollection, sizeof(VendorCollection) };
+    sections[3] = (struct DescriptorSection){ VendorReportItems, sizeof(VendorReportItems) };
+    sections[4] = (struct DescriptorSection){ EndCollection, sizeof(EndCollection) };
+    sections[5] = (struct DescriptorSection){ EndCollection, sizeof(EndCollection) };
+    return 6;
+}
+
+static uint16_t GetReportDescriptorLength(void)
+{
+    return sizeof(JoystickReportHeader) + g_ActiveLayout.m_descriptorLength + sizeof(VendorCollection) + sizeof(VendorReportItems) + 2 * sizeof(EndCollection);
+}
+
+static uint8_t ReadConfigurationDescriptor(uint8_t* data, uint8_t offset, uint8_t length)
+{
+    if (offset >= sizeof(usbDescriptorConfiguration))
+        return 0;
+
+    if (length > sizeof(usbDescriptorConfiguration) - offset)
+    {
+        length = sizeof(usbDescriptorConfiguration) - offset;
+    }
+
+    memcpy_P(data, usbDescriptorConfiguration + offset, length);
+
+    uint16_t reportLength = GetReportDescriptorLength();
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (offset + i == HID_REPORT_LENGTH_OFFSET)
+        {
+            data[i] = reportLength & 0xFF;
+        }
+        else if (offset + i == HID_REPORT_LENGTH_OFFSET + 1)
+        {
+            data[i] = reportLength >> 8;
+        }
+    }
+
+    return length;
+}
+
+usbMsgLen_t usbFunctionDescriptor(struct usbRequest* rq)
+{
+    g_DescriptorType = rq->wValue.bytes[1];
+    g_DescriptorPosition = 0;
+    return USB_NO_MSG;
+}
+
+uchar usbFunctionRead(uchar* data, uchar len)
+{
+    uint8_t length = 0;
+
+    switch (g_DescriptorType)
+    {
+    case USBDESCR_CONFIG:
+        length = ReadConfigurationDescriptor(data, g_DescriptorPosition, len);
+        break;
+    case USBDESCR_HID:
+        if (len > HID_DESCRIPTOR_LENGTH - g_DescriptorPosition)
+        {
+            len = HID_DESCRIPTOR_LENGTH - g_DescriptorPosition;
+        }
+
+        length = ReadConfigurationDescriptor(data, HID_DESCRIPTOR_OFFSET + g_DescriptorPosition, len);
+        break;
+    case USBDESCR_HID_REPORT:
+    {
+        struct DescriptorSection sections[6];
+        length = CopySections(data, g_DescriptorPosition, len, sections, GetReportDescriptorSections(sections));
+        break;
+    }
+    }
+
+    g_DescriptorPosition += length;
+    return length;
+}
+
+void SetUsbReportLayout(uint8_t layout)
+{
+    memcpy_P(&g_ActiveLayout, &g_ReportLayouts[layout], sizeof(g_ActiveLayout));
+}
 
 #elif defined(USB_LUFA)
 
@@ -87,13 +439,11 @@ typedef struct
     USB_Descriptor_Interface_t HID_Interface;
     USB_HID_Descriptor_HID_t HID_JoystickHID;
     USB_Descriptor_Endpoint_t HID_ReportINEndpoint;
+    USB_Descriptor_Interface_t HID_VendorInterface;
+    USB_HID_Descriptor_HID_t HID_VendorHID;
+    USB_Descriptor_Endpoint_t HID_VendorReportINEndpoint;
 } USB_Descriptor_Configuration_t;
 
-enum InterfaceDescriptors_t
-{
-    INTERFACE_ID_Joystick = 0,
-};
-
 enum StringDescriptors_t
 {
     STRING_ID_Language,
@@ -102,67 +452,24 @@ enum StringDescriptors_t
     STRING_ID_Serial,
 };
 
-static const USB_Descriptor_HIDReport_Datatype_t JoystickReport[] PROGMEM =
+// Configuration and diagnostics live on their own interface, so games own the joystick
+// interface exclusively. The axis report is repeated here for the configuration tool.
+static const uint8_t VendorReportHeader[] PROGMEM =
 {
-    HID_RI_USAGE_PAGE(8, 0x01), // USAGE_PAGE (Generic Desktop)
-    HID_RI_USAGE(8, 0x04),      // USAGE (Joystick)
-    HID_RI_COLLECTION(8, 0x01), // COLLECTION (Application)
-        HID_RI_USAGE(8, 0x01),      //   USAGE (Pointer)
-        HID_RI_REPORT_ID(8, 1),
-        HID_RI_REPORT_SIZE(8, 0x08),
-        HID_RI_LOGICAL_MINIMUM(8, 0),
-        HID_RI_LOGICAL_MAXIMUM(16, 255),
-        HID_RI_PHYSICAL_MINIMUM(8, 0),
-        HID_RI_PHYSICAL_MAXIMUM(16, 255),
-        HID_RI_COLLECTION(8, 0x00), // COLLECTION (Physical)
-            HID_RI_USAGE(8, 0x30),  // USAGE (X)
-            HID_RI_USAGE(8, 0x31),  // USAGE (Y)
-            HID_RI_REPORT_COUNT(8, 0x02),
-            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_END_COLLECTION(0),
-        HID_RI_COLLECTION(8, 0x00), // COLLECTION (Physical)
-            HID_RI_USAGE(8, 0x32),  // USAGE (Z)
-            HID_RI_USAGE(8, 0x33),  // USAGE (Rx)
-            HID_RI_REPORT_COUNT(8, 0x02),
-            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_END_COLLECTION(0),
-        HID_RI_COLLECTION(8, 0x00), // COLLECTION (Physical)
-            HID_RI_USAGE(8, 0x34),  // USAGE (Ry)
-            HID_RI_USAGE(8, 0x35),  // USAGE (Rz)
-            HID_RI_USAGE(8, 0x36),  // USAGE (Slider)
-            HID_RI_REPORT_COUNT(8, 0x03),
-            HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_END_COLLECTION(0),
-        HID_RI_COLLECTION(8, 0x02), // COLLECTION (Logical)
-            HID_RI_USAGE_PAGE(16, 0x00FF), // USAGE_PAGE (Vendor Defined Page 1)
-            HID_RI_REPORT_ID(8, UsbEnhancedReportId),
-            HID_RI_REPORT_COUNT(8, sizeof(struct UsbEnhancedReport)),
-            HID_RI_USAGE(8, UsbEnhancedReportId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_RI_REPORT_ID(8, ConfigurationReportId),
-            HID_RI_REPORT_COUNT(8, sizeof(struct Configuration)),
-            HID_RI_USAGE(8, ConfigurationReportId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_RI_REPORT_ID(8, LoadConfigurationDefaultsId),
-            HID_RI_REPORT_COUNT(8, 1),
-            HID_RI_USAGE(8, LoadConfigurationDefaultsId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_RI_REPORT_ID(8, ReadConfigurationFromEepromId),
-            HID_RI_REPORT_COUNT(8, 1),
-            HID_RI_USAGE(8, ReadConfigurationFromEepromId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_RI_REPORT_ID(8, WriteConfigurationToEepromId),
-            HID_RI_REPORT_COUNT(8, 1),
-            HID_RI_USAGE(8, WriteConfigurationToEepromId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_RI_REPORT_ID(8, JumpToBootloaderId),
-            HID_RI_REPORT_COUNT(8, 1),
-            HID_RI_USAGE(8, JumpToBootloaderId),
-            HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-        HID_RI_END_COLLECTION(0),
-    HID_RI_END_COLLECTION(0),
+    0x06, 0x00, 0xFF,   // USAGE_PAGE (Vendor Defined Page 1)
+    0x09, 0x01,         // USAGE (Vendor Usage 1)
+    0xA1, 0x01,         // COLLECTION (Application)
+    0x05, 0x01,         //   USAGE_PAGE (Generic Desktop)
 };
 
+#define MAX_LAYOUT_DESCRIPTOR_LENGTH sizeof(union { uint8_t a[sizeof(Axes7Report)]; uint8_t b[sizeof(Axes4Report)]; uint8_t c[sizeof(Axes16Report)]; uint8_t d[sizeof(ButtonsReport)]; })
+
+// The report descriptors are assembled in RAM for the active layout
+static uint8_t JoystickReport[sizeof(JoystickReportHeader) + MAX_LAYOUT_DESCRIPTOR_LENGTH + sizeof(EndCollection)];
+static uint8_t VendorReport[sizeof(VendorReportHeader) + MAX_LAYOUT_DESCRIPTOR_LENGTH + sizeof(VendorReportItems) + sizeof(EndCollection)];
+static uint8_t g_JoystickReportLength;
+static uint8_t g_VendorReportLength;
+
 static const USB_Descriptor_Device_t DeviceDescriptor PROGMEM =
 {
     { sizeof(USB_Descriptor_Device_t), DTYPE_Device },
@@ -180,12 +487,12 @@ static const USB_Descriptor_Device_t DeviceDescriptor PROGMEM =
     FIXED_NUM_CONFIGURATIONS,
 };
 
-static const USB_Descriptor_Configuration_t ConfigurationDescriptor PROGMEM =
+static USB_Descriptor_Configuration_t ConfigurationDescriptor =
 {
     {
         { sizeof(USB_Descriptor_Configuration_Header_t), DTYPE_Configuration },
         sizeof(USB_Descriptor_Configuration_t),
-        1,
+        2,
         1,
         NO_DESCRIPTOR,
         (USB_CONFIG_ATTR_RESERVED),
@@ -207,14 +514,39 @@ static const USB_Descriptor_Configuration_t ConfigurationDescriptor PROGMEM =
         0x00,
         1,
         HID_DTYPE_Report,
-        sizeof(JoystickReport),
+        0,
     },
     {
         { sizeof(USB_Descriptor_Endpoint_t), DTYPE_Endpoint },
         JOYSTICK_EPADDR,
         (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
         JOYSTICK_EPSIZE,
-        20,
+        JOYSTICK_POLLING_INTERVAL,
+    },
+    {
+        { sizeof(USB_Descriptor_Interface_t), DTYPE_Interface },
+        INTERFACE_ID_Vendor,
+        0x00,
+        1,
+        HID_CSCP_HIDClass,
+        HID_CSCP_NonBootSubclass,
+        HID_CSCP_NonBootProtocol,
+        NO_DESCRIPTOR,
+    },
+    {
+        { sizeof(USB_HID_Descriptor_HID_t), HID_DTYPE_HID },
+        VERSION_BCD(1, 1, 1),
+        0x00,
+        1,
+        HID_DTYPE_Report,
+        0,
+    },
+    {
+        { sizeof(USB_Descriptor_Endpoint_t), DTYPE_Endpoint },
+        VENDOR_EPADDR,
+        (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+        VENDOR_EPSIZE,
+        VENDOR_POLLING_INTERVAL,
     },
 };
 
@@ -223,17 +555,45 @@ static const USB_Descriptor_String_t ManufacturerString PROGMEM = USB_STRING_DES
 static const USB_Descriptor_String_t ProductString PROGMEM = USB_STRING_DESCRIPTOR(L"R/C to PC Joystick");
 static const USB_Descriptor_String_t SerialString PROGMEM = USB_STRING_DESCRIPTOR(L"greuel.org:hidrcjoy");
 
-uint16_t CALLBACK_USB_GetDescriptor(uint16_t wValue, uint16_t wIndex, const void** descriptor)
+void SetUsbReportLayout(uint8_t layout)
+{
+    memcpy_P(&g_ActiveLayout, &g_ReportLayouts[layout], sizeof(g_ActiveLayout));
+
+    struct DescriptorSection joystickSections[] =
+    {
+        { JoystickReportHeader, sizeof(JoystickReportHeader) },
+        { g_ActiveLayout.m_descriptor, g_ActiveLayout.m_descriptorLength },
+        { EndCollection, sizeof(EndCollection) },
+    };
+
+    struct DescriptorSection vendorSections[] =
+    {
+        { VendorReportHeader, sizeof(VendorReportHeader) },
+        { g_ActiveLayout.m_descriptor, g_ActiveLayout.m_descriptorLength },
+        { VendorReportItems, sizeof(VendorReportItems) },
+        { EndCollection, sizeof(EndCollection) },
+    };
+
+    g_JoystickReportLength = CopySections(JoystickReport, 0, sizeof(JoystickReport), joystickSections, 3);
+    g_VendorReportLength = CopySections(VendorReport, 0, sizeof(VendorReport), vendorSections, 4);
+    ConfigurationDescriptor.HID_JoystickHID.HIDReportLength = g_JoystickReportLength;
+    ConfigurationDescriptor.HID_VendorHID.HIDReportLength = g_VendorReportLength;
+}
+
+uint16_t CALLBACK_USB_GetDescriptor(uint16_t wValue, uint16_t wIndex, const void** descriptor, uint8_t* memorySpace)
 {
     uint8_t descriptorType = (wValue >> 8);
     uint8_t descriptorNumber = (wValue & 0xFF);
 
+    *memorySpace = MEMSPACE_FLASH;
+
     switch (descriptorType)
     {
     case DTYPE_Device:
         *descriptor = &DeviceDescriptor;
         return sizeof(USB_Descriptor_Device_t);
     case DTYPE_Configuration:
+        *memorySpace = MEMSPACE_RAM;
         *descriptor = &ConfigurationDescriptor;
         return sizeof(USB_Descriptor_Configuration_t);
     case DTYPE_String:
@@ -254,11 +614,29 @@ uint16_t CALLBACK_USB_GetDescriptor(uint16_t wValue, uint16_t wIndex, const void
         }
         break;
     case DTYPE_HID:
-        *descriptor = &ConfigurationDescriptor.HID_JoystickHID;
-        return sizeof(USB_HID_Descriptor_HID_t);
+        *memorySpace = MEMSPACE_RAM;
+        switch (wIndex)
+        {
+        case INTERFACE_ID_Joystick:
+            *descriptor = &ConfigurationDescriptor.HID_JoystickHID;
+            return sizeof(USB_HID_Descriptor_HID_t);
+        case INTERFACE_ID_Vendor:
+            *descriptor = &ConfigurationDescriptor.HID_VendorHID;
+            return sizeof(USB_HID_Descriptor_HID_t);
+        }
+        break;
     case DTYPE_Report:
-        *descriptor = &JoystickReport;
-        return sizeof(JoystickReport);
+        *memorySpace = MEMSPACE_RAM;
+        switch (wIndex)
+        {
+        case INTERFACE_ID_Joystick:
+            *descriptor = JoystickReport;
+            return g_JoystickReportLength;
+        case INTERFACE_ID_Vendor:
+            *descriptor = VendorReport;
+            return g_VendorReportLength;
+        }
+        break;
     }
 
     return NO_DESCRIPTOR;
@@ -4,10 +4,46 @@
 //
 
 #pragma once
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "UsbReports.h"
 
 /////////////////////////////////////////////////////////////////////////////
 
 #define JOYSTICK_EPADDR (ENDPOINT_DIR_IN | 1)
-#define JOYSTICK_EPSIZE 8
+#define JOYSTICK_EPSIZE 16
+#define JOYSTICK_POLLING_INTERVAL 1
+#define VENDOR_EPADDR (ENDPOINT_DIR_IN | 2)
+#define VENDOR_EPSIZE 8
+#define VENDOR_POLLING_INTERVAL 1
 #define DTYPE_HID 0x21
 #define DTYPE_Report 0x22
+
+enum InterfaceDescriptors_t
+{
+    INTERFACE_ID_Joystick = 0,
+    INTERFACE_ID_Vendor = 1,
+};
+
+// Describes the input reports of a report layout
+struct ReportLayout
+{
+    const uint8_t* m_descriptor; // axis section of the report descriptor
+    uint8_t m_descriptorLength;
+    uint8_t m_reportId; // ID of the first report
+    uint8_t m_reportParts; // number of consecutive report IDs
+    uint8_t m_reportSize; // size of each report including the report ID
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const struct ReportLayout g_ReportLayouts[ReportLayoutCount] PROGMEM;
+
+// Selects the report descriptor served on the next enumeration
+void SetUsbReportLayout(uint8_t layout);
+
+#ifdef __cplusplus
+}
+#endif
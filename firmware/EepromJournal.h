@@ -0,0 +1,107 @@
+//
+// EepromJournal.h
+// Copyright (C) 2018 Marius Greuel. All rights reserved.
+//
+
+#pragma once
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "EepromWriter.h"
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Stores a record in a ring of EEPROM slots, to spread the wear over all slots.
+// Each save goes to the slot after the newest one, followed by a trailer with a
+// sequence number and a CRC. The writer computes the CRC over the bytes it wrote
+// and writes it last, so an interrupted save leaves the previous record as the
+// newest valid one.
+class EepromJournal
+{
+public:
+    struct Trailer
+    {
+        uint8_t m_sequence;
+        uint16_t m_crc;
+    };
+
+    void Initialize(void* eeprom, uint16_t recordSize, uint8_t slotCount)
+    {
+        m_eeprom = static_cast<uint8_t*>(eeprom);
+        m_recordSize = recordSize;
+        m_slotCount = slotCount;
+    }
+
+    // Reads the newest record with a valid CRC, returns false if there is none
+    bool Read(void* record)
+    {
+        bool found = false;
+
+        for (uint8_t slot = 0; slot < m_slotCount; slot++)
+        {
+            Trailer trailer;
+            eeprom_read_block(&trailer, GetSlot(slot) + m_recordSize, sizeof(trailer));
+
+            if (trailer.m_crc != GetEepromCrc(slot, trailer.m_sequence))
+                continue;
+
+            // Sequence numbers wrap around, so compare the difference
+            if (!found || static_cast<int8_t>(trailer.m_sequence - m_sequence) > 0)
+            {
+                found = true;
+                m_slot = slot;
+                m_sequence = trailer.m_sequence;
+            }
+        }
+
+        if (found)
+        {
+            eeprom_read_block(record, GetSlot(m_slot), m_recordSize);
+        }
+
+        return found;
+    }
+
+    // Queues the record for the next slot
+    void Write(EepromWriter& writer, const void* record)
+    {
+        m_slot = m_slot + 1 < m_slotCount ? m_slot + 1 : 0;
+        m_sequence++;
+        Rewrite(writer, record);
+    }
+
+    // Queues the record for the slot of the last write, which has to be incomplete.
+    // Advancing instead would overwrite the slot before it, which may be the only valid one.
+    void Rewrite(EepromWriter& writer, const void* record)
+    {
+        uint8_t* slot = GetSlot(m_slot);
+        Trailer* trailer = reinterpret_cast<Trailer*>(slot + m_recordSize);
+        writer.Add(slot, record, m_recordSize, true);
+        writer.Add(&trailer->m_sequence, &m_sequence, sizeof(m_sequence), true);
+        writer.AddCrc(&trailer->m_crc);
+    }
+
+private:
+    uint8_t* GetSlot(uint8_t slot) const
+    {
+        return m_eeprom + slot * (m_recordSize + sizeof(Trailer));
+    }
+
+    uint16_t GetEepromCrc(uint8_t slot, uint8_t sequence) const
+    {
+        const uint8_t* record = GetSlot(slot);
+        uint16_t crc = 0xFFFF;
+        for (uint16_t i = 0; i < m_recordSize; i++)
+        {
+            crc = _crc_ccitt_update(crc, eeprom_read_byte(record + i));
+        }
+
+        return _crc_ccitt_update(crc, sequence);
+    }
+
+    uint8_t* m_eeprom = nullptr;
+    uint16_t m_recordSize = 0;
+    uint8_t m_slotCount = 0;
+    uint8_t m_slot = 0;
+    uint8_t m_sequence = 0;
+};
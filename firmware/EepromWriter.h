@@ -0,0 +1,120 @@
+//
+// EepromWriter.h
+// Copyright (C) 2018 Marius Greuel. All rights reserved.
+//
+
+#pragma once
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Writes blocks to the EEPROM in the background, one byte per call of Update.
+// Writing a byte takes about 3.4 ms, during which the main loop keeps running.
+// Blocks can be checksummed with a CRC of the bytes as they were written, since
+// the data may change in RAM while it is written.
+class EepromWriter
+{
+    static const uint8_t maxBlocks = 5;
+
+    struct Block
+    {
+        uint8_t* m_eeprom;
+        const uint8_t* m_data; // nullptr for the CRC
+        uint16_t m_size;
+        bool m_checksummed;
+    };
+
+public:
+    void Clear()
+    {
+        m_blockCount = 0;
+        m_busy = false;
+    }
+
+    // Queues a block, which is read from RAM while it is written
+    void Add(void* eeprom, const void* data, uint16_t size, bool checksummed = false)
+    {
+        if (m_blockCount < maxBlocks)
+        {
+            Block& block = m_blocks[m_blockCount++];
+            block.m_eeprom = static_cast<uint8_t*>(eeprom);
+            block.m_data = static_cast<const uint8_t*>(data);
+            block.m_size = size;
+            block.m_checksummed = checksummed;
+        }
+    }
+
+    // Queues the CRC-CCITT of the checksummed blocks before it, as a 16-bit word
+    void AddCrc(void* eeprom)
+    {
+        Add(eeprom, nullptr, sizeof(m_crc));
+    }
+
+    // Starts writing the queued blocks
+    void Start()
+    {
+        m_currentBlock = 0;
+        m_position = 0;
+        m_crc = 0xFFFF;
+        m_busy = m_blockCount > 0;
+    }
+
+    bool IsBusy() const
+    {
+        return m_busy;
+    }
+
+    // Returns the number of bytes left to compare or write
+    uint16_t GetBytesRemaining() const
+    {
+        if (!m_busy)
+            return 0;
+
+        uint16_t bytes = m_blocks[m_currentBlock].m_size - m_position;
+        for (uint8_t i = m_currentBlock + 1; i < m_blockCount; i++)
+        {
+            bytes += m_blocks[i].m_size;
+        }
+
+        return bytes;
+    }
+
+    void Update()
+    {
+        if (!m_busy || !eeprom_is_ready())
+            return;
+
+        // Bytes that already match are skipped without a write cycle
+        const Block& block = m_blocks[m_currentBlock];
+        uint8_t* address = block.m_eeprom + m_position;
+        uint8_t value = block.m_data != nullptr ? block.m_data[m_position] : reinterpret_cast<const uint8_t*>(&m_crc)[m_position];
+        if (eeprom_read_byte(address) != value)
+        {
+            eeprom_write_byte(address, value);
+        }
+
+        if (block.m_checksummed)
+        {
+            m_crc = _crc_ccitt_update(m_crc, value);
+        }
+
+        if (++m_position >= block.m_size)
+        {
+            m_position = 0;
+            if (++m_currentBlock >= m_blockCount)
+            {
+                m_busy = false;
+            }
+        }
+    }
+
+private:
+    Block m_blocks[maxBlocks];
+    uint8_t m_blockCount = 0;
+    uint8_t m_currentBlock = 0;
+    uint16_t m_position = 0;
+    uint16_t m_crc = 0xFFFF;
+    bool m_busy = false;
+};
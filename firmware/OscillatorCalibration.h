@@ -0,0 +1,74 @@
+//
+// OscillatorCalibration.h
+// Copyright (C) 2018 Marius Greuel. All rights reserved.
+//
+
+#pragma once
+#include <stdint.h>
+#include <avr/io.h>
+
+/////////////////////////////////////////////////////////////////////////////
+
+extern "C" unsigned usbMeasureFrameLength(void);
+
+class OscillatorCalibration
+{
+    // usbMeasureFrameLength() returns 1/7 of the CPU cycles in one 1 ms USB frame
+    static const uint16_t targetFrameLength = static_cast<uint16_t>((1499UL * (F_CPU / 1000) + 5250) / 10500);
+
+public:
+    static const uint16_t unityCorrection = 0x8000;
+
+    // Must be called with interrupts disabled, immediately after a USB reset
+    void Calibrate()
+    {
+        // OSCCAL bit 7 selects one of two overlapping frequency ranges,
+        // so do a binary search on the lower seven bits only
+        uint8_t range = OSCCAL & 0x80;
+        uint8_t trialValue = 0;
+        for (uint8_t step = 0x40; step > 0; step >>= 1)
+        {
+            OSCCAL = range | trialValue | step;
+            if (usbMeasureFrameLength() < targetFrameLength)
+            {
+                trialValue |= step;
+            }
+        }
+
+        // The binary search is accurate to +/- 1, so check the neighbors
+        uint8_t optimumValue = trialValue;
+        uint16_t optimumFrameLength = 0;
+        uint16_t optimumDeviation = 0xFFFF;
+        uint8_t firstValue = trialValue > 0 ? trialValue - 1 : 0;
+        uint8_t lastValue = trialValue < 0x7F ? trialValue + 1 : 0x7F;
+        for (uint8_t value = firstValue; value <= lastValue; value++)
+        {
+            OSCCAL = range | value;
+            uint16_t frameLength = usbMeasureFrameLength();
+            uint16_t deviation = frameLength > targetFrameLength ? frameLength - targetFrameLength : targetFrameLength - frameLength;
+            if (deviation < optimumDeviation)
+            {
+                optimumValue = value;
+                optimumFrameLength = frameLength;
+                optimumDeviation = deviation;
+            }
+        }
+
+        OSCCAL = range | optimumValue;
+        m_frameLength = optimumFrameLength;
+    }
+
+    // Returns the residual clock error as a Q1.15 factor, which converts
+    // nominal time values, derived from F_CPU, to real time values
+    uint16_t GetCorrection() const
+    {
+        // The factor has to stay below 2.0, else it does not fit the 16 bits
+        if (m_frameLength <= targetFrameLength / 2)
+            return unityCorrection;
+
+        return static_cast<uint16_t>(static_cast<uint32_t>(targetFrameLength) * unityCorrection / m_frameLength);
+    }
+
+private:
+    uint16_t m_frameLength = 0;
+};
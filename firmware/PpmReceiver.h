@@ -5,6 +5,7 @@
 
 #pragma once
 #include <stdint.h>
+#include "Board.h"
 #include "Configuration.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -20,10 +21,19 @@ public:
 
     void SetConfiguration(uint16_t minSyncPulseWidth, bool invertedSignal)
     {
+        m_minSyncPulseWidthUs = minSyncPulseWidth;
         m_minSyncPulseWidth = UsToTicks(minSyncPulseWidth);
         m_invertedSignal = invertedSignal;
     }
 
+#if HIDRCJOY_OSCCAL
+    void SetClockCorrection(uint16_t correction)
+    {
+        m_clockCorrection = correction;
+        m_minSyncPulseWidth = UsToTicks(m_minSyncPulseWidthUs);
+    }
+#endif
+
     void Update(uint32_t time)
     {
         uint8_t updateCounter = m_updateCounter;
@@ -36,10 +46,20 @@ public:
         }
         else
         {
+#if HIDRCJOY_SRXL
+            uint32_t period = time - m_lastUpdateTime;
+            m_framePeriod = period < 0xFFFF ? period : 0xFFFF;
+#endif
             m_lastUpdateCount = updateCounter;
             m_lastUpdateTime = time;
             m_isDataAvailable = true;
         }
+
+#if HIDRCJOY_SRXL
+        // A frame overdue by half a frame period counts as missing, which
+        // allows the receiver to fail over long before the signal timeout
+        m_isFrameCurrent = m_isDataAvailable && time - m_lastUpdateTime <= m_framePeriod + m_framePeriod / 2;
+#endif
     }
 
     void OnPinChanged(bool level, uint16_t time)
@@ -52,8 +72,16 @@ public:
 
         if (diff >= m_minSyncPulseWidth)
         {
+            // A frame with a different number of channels than the previous one
+            // is only known to be complete at the next sync pulse
+            if (m_currentChannel > 0 && m_currentChannel != m_channelCount)
+            {
+                m_channelCount = m_currentChannel;
+                m_frameTime = time;
+                m_updateCounter++;
+            }
+
             m_currentChannel = 0;
-            m_updateCounter++;
         }
         else if (m_currentChannel < Configuration::maxChannels)
         {
@@ -61,6 +89,13 @@ public:
             m_channelPulseWidth[m_currentChannel] = diff;
             sei();
             m_currentChannel++;
+
+            // Signal the frame as soon as its last channel was received
+            if (m_currentChannel == m_channelCount)
+            {
+                m_frameTime = time;
+                m_updateCounter++;
+            }
         }
     }
 
@@ -69,6 +104,28 @@ public:
         return m_isDataAvailable;
     }
 
+#if HIDRCJOY_SRXL
+    // Returns true if the last frame arrived in time
+    bool IsFrameCurrent() const
+    {
+        return m_isFrameCurrent;
+    }
+#endif
+
+    uint8_t GetUpdateCounter() const
+    {
+        return m_updateCounter;
+    }
+
+    // Returns the timer ticks of the last edge of the most recent frame
+    uint16_t GetFrameTime() const
+    {
+        cli();
+        uint16_t value = m_frameTime;
+        sei();
+        return value;
+    }
+
     uint16_t GetChannelPulseWidth(uint8_t channel) const
     {
         cli();
@@ -79,19 +136,21 @@ public:
 
     uint16_t TicksToUs(uint16_t value) const
     {
-#if defined (__AVR_ATtiny85__)
-        return value * (64 * 2) / (2 * F_CPU / 1000000);
+        uint32_t us = static_cast<uint32_t>(value) * (Board::timerPrescaler * 2) / (2 * F_CPU / 1000000);
+#if HIDRCJOY_OSCCAL
+        return static_cast<uint16_t>((us * m_clockCorrection) >> 15);
 #else
-        return value * 8 / (F_CPU / 1000000);
+        return static_cast<uint16_t>(us);
 #endif
     }
 
     uint16_t UsToTicks(uint16_t value) const
     {
-#if defined (__AVR_ATtiny85__)
-        return value * (2 * F_CPU / 1000000) / (64 * 2);
+        uint32_t ticks = static_cast<uint32_t>(value) * (2 * F_CPU / 1000000) / (Board::timerPrescaler * 2);
+#if HIDRCJOY_OSCCAL
+        return static_cast<uint16_t>((ticks << 15) / m_clockCorrection);
 #else
-        return value * (F_CPU / 1000000) / 8;
+        return static_cast<uint16_t>(ticks);
 #endif
     }
 
@@ -99,13 +158,23 @@ public:
     uint32_t m_frequency;
 
 private:
+    uint16_t m_minSyncPulseWidthUs = 0;
     uint16_t m_minSyncPulseWidth = 0;
+#if HIDRCJOY_OSCCAL
+    uint16_t m_clockCorrection = 0x8000;
+#endif
     bool m_invertedSignal = false;
     uint16_t m_lastTime = 0;
     volatile uint16_t m_channelPulseWidth[Configuration::maxChannels] = {};
     uint8_t m_currentChannel = 0;
+    uint8_t m_channelCount = 0;
     volatile uint8_t m_updateCounter = 0;
+    volatile uint16_t m_frameTime = 0;
     uint8_t m_lastUpdateCount = 0;
     uint32_t m_lastUpdateTime = 0;
     bool m_isDataAvailable = false;
+#if HIDRCJOY_SRXL
+    uint16_t m_framePeriod = 0;
+    bool m_isFrameCurrent = false;
+#endif
 };
@@ -4,15 +4,32 @@
 //
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
 #include "Configuration.h"
 #include "UsbReports.h"
+#include "Timer.h"
 #include "PpmReceiver.h"
 #if HIDRCJOY_SRXL
 #include "SrxlReceiver.h"
 #endif
+
+// The prediction extrapolates the filtered pulse widths
+#if HIDRCJOY_UPSAMPLING && !HIDRCJOY_FILTERS
+#error HIDRCJOY_UPSAMPLING requires HIDRCJOY_FILTERS
+#endif
 /////////////////////////////////////////////////////////////////////////////
 
+#if HIDRCJOY_CURVES
+// x^3 for x = 0..1 in 16 segments, scaled to 0..32767
+static const uint16_t g_ExpoTable[17] PROGMEM =
+{
+    0, 8, 64, 216, 512, 1000, 1728, 2744, 4096, 5832, 8000, 10648, 13824, 17575, 21951, 26999, 32767
+};
+#endif
+
 class Receiver
 {
 public:
@@ -26,122 +43,1073 @@ public:
 
     void LoadDefaultConfiguration()
     {
-        m_Configuration.m_version = Configuration::version;
-        m_Configuration.m_flags = 0;
-        m_Configuration.m_minSyncPulseWidth = 3500;
-        m_Configuration.m_centerChannelPulseWidth = 1500;
-        m_Configuration.m_channelPulseWidthRange = 550;
-        m_Configuration.m_polarity = 0;
+        for (uint8_t i = 0; i < HIDRCJOY_PROFILES; i++)
+        {
+            LoadDefaultProfile(m_Profiles[i]);
+        }
+
+#if HIDRCJOY_PROFILES > 1
+        LoadDefaultProfileConfiguration();
+#endif
+        SelectProfile(0);
+    }
+
+#if HIDRCJOY_PROFILES > 1
+    void LoadDefaultProfileConfiguration()
+    {
+        m_ProfileConfiguration.m_profileCount = HIDRCJOY_PROFILES;
+        m_ProfileConfiguration.m_activeProfile = 0;
+        m_ProfileConfiguration.m_selectChannel = ProfileConfiguration::noSelectChannel;
+    }
+
+    bool IsValidProfileConfiguration() const
+    {
+        return m_ProfileConfiguration.m_profileCount == HIDRCJOY_PROFILES &&
+            m_ProfileConfiguration.m_activeProfile < HIDRCJOY_PROFILES &&
+            (m_ProfileConfiguration.m_selectChannel < Configuration::maxChannels ||
+            m_ProfileConfiguration.m_selectChannel == ProfileConfiguration::noSelectChannel);
+    }
+
+    // Applies a profile selected by the host, until the selection channel moves
+    void UpdateProfileConfiguration()
+    {
+        if (!IsValidProfileConfiguration())
+        {
+            LoadDefaultProfileConfiguration();
+        }
+
+        // The selection channel stays where it is, so it does not override the selection
+        m_selectPosition = GetSelectPosition(0xFF);
+        SelectProfile(m_ProfileConfiguration.m_activeProfile);
+    }
+#endif
+
+#if HIDRCJOY_MIXER
+    // The default matrix passes each channel through to its axis
+    void LoadDefaultMixer()
+    {
+        m_Mixer.m_enabled = 0;
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            for (uint8_t j = 0; j < Configuration::maxChannels; j++)
+            {
+                m_Mixer.m_matrix[i][j] = i == j ? MixerConfiguration::unity : 0;
+            }
+        }
+    }
+
+    static bool IsValidMixer(const MixerConfiguration& mixer)
+    {
+        if (mixer.m_enabled > 1)
+            return false;
 
-        for (uint8_t i = 0; i < sizeof(m_Configuration.m_mapping); i++)
+        // Limits the sum of products to 32 bits
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
         {
-            m_Configuration.m_mapping[i] = i;
+            for (uint8_t j = 0; j < Configuration::maxChannels; j++)
+            {
+                int16_t coefficient = mixer.m_matrix[i][j];
+                if (coefficient < -MixerConfiguration::maxCoefficient || coefficient > MixerConfiguration::maxCoefficient)
+                {
+                    return false;
+                }
+            }
         }
+
+        return true;
+    }
+
+    // Applies a mixer received from the host, an invalid one leaves the current mixer in effect.
+    // Returns true if the mixer was applied.
+    bool SetMixer(const MixerConfiguration& mixer)
+    {
+        if (!IsValidMixer(mixer))
+            return false;
+
+        m_Mixer = mixer;
+        return true;
     }
+#endif
 
     void UpdateConfiguration()
     {
-        m_PpmReceiver.SetConfiguration(m_Configuration.m_minSyncPulseWidth, (m_Configuration.m_flags & Configuration::Flags::InvertedSignal) != 0);
+        for (uint8_t i = 0; i < HIDRCJOY_PROFILES; i++)
+        {
+            UpdateGains(i);
+        }
+
+        UpdateReceiverConfiguration();
     }
 
     bool IsValidConfiguration() const
     {
-        if (m_Configuration.m_version != Configuration::version)
+        for (uint8_t i = 0; i < HIDRCJOY_PROFILES; i++)
+        {
+            if (!IsValidProfile(m_Profiles[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Replaces the active profile with one received from the host, an invalid one leaves the profile unchanged.
+    // Returns true if the profile was replaced.
+    bool SetConfiguration(const Configuration& config)
+    {
+        if (!IsValidProfile(config))
+            return false;
+
+        *m_Configuration = config;
+        UpdateConfiguration();
+        return true;
+    }
+
+    // Changes a few bytes of the active profile, and only updates the state derived from them.
+    // A patch that would make the configuration invalid is undone.
+    bool PatchConfiguration(uint8_t offset, uint8_t length, const uint8_t* data)
+    {
+        if (length > USB_CONFIGURATION_PATCH_SIZE || offset >= sizeof(Configuration) || length > sizeof(Configuration) - offset)
+            return false;
+
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(m_Configuration) + offset;
+        uint8_t previous[USB_CONFIGURATION_PATCH_SIZE];
+        memcpy(previous, bytes, length);
+        memcpy(bytes, data, length);
+
+        if (!IsValidProfile(*m_Configuration))
+        {
+            memcpy(bytes, previous, length);
+            return false;
+        }
+
+        if (IsPatched(offset, length, offsetof(Configuration, m_flags), sizeof(m_Configuration->m_flags)) ||
+            IsPatched(offset, length, offsetof(Configuration, m_minSyncPulseWidth), sizeof(m_Configuration->m_minSyncPulseWidth)))
+        {
+            UpdateReceiverConfiguration();
+        }
+
+        // The deadband is part of the curves, and scales the gains
+#if HIDRCJOY_CURVES
+        const uint8_t gainsEnd = offsetof(Configuration, m_customCurves);
+#else
+        const uint8_t gainsEnd = offsetof(Configuration, m_calibration) + sizeof(m_Configuration->m_calibration);
+#endif
+        if (IsPatched(offset, length, offsetof(Configuration, m_centerChannelPulseWidth), offsetof(Configuration, m_polarity) - offsetof(Configuration, m_centerChannelPulseWidth)) ||
+            IsPatched(offset, length, offsetof(Configuration, m_calibratedChannels), gainsEnd - offsetof(Configuration, m_calibratedChannels)))
+        {
+            UpdateGains(GetProfile());
+        }
+
+        return true;
+    }
+
+    uint8_t GetProfile() const
+    {
+        return m_Configuration - m_Profiles;
+    }
+
+    // Switching profiles only swaps pointers, the gains of all profiles are precomputed
+    void SelectProfile(uint8_t profile)
+    {
+        m_Configuration = &m_Profiles[profile];
+        m_gains = &m_profileGains[profile];
+#if HIDRCJOY_CURVES
+        m_inDeadband = 0;
+#endif
+#if HIDRCJOY_PROFILES > 1
+        m_ProfileConfiguration.m_activeProfile = profile;
+#endif
+        UpdateReceiverConfiguration();
+    }
+
+    // The report layout of the first profile applies to all profiles,
+    // so that switching profiles does not require a USB reconnect
+    uint8_t GetReportLayout() const
+    {
+        return m_Profiles[0].m_reportLayout;
+    }
+
+    // Starts recording the channel extremes, while the user moves the sticks to their endpoints
+    void StartCalibration()
+    {
+        m_calibrating = true;
+        m_Configuration->m_calibratedChannels = 0;
+        UpdateGains(GetProfile());
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            m_Configuration->m_calibration[i].m_minPulseWidth = Configuration::maxChannelPulseWidth;
+            m_Configuration->m_calibration[i].m_maxPulseWidth = Configuration::minChannelPulseWidth;
+        }
+    }
+
+    // Takes the current stick positions as center, and applies the calibration to all
+    // channels that have moved far enough to both sides
+    void FinishCalibration()
+    {
+        if (!m_calibrating)
+            return;
+
+        m_calibrating = false;
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            ChannelCalibration& calibration = m_Configuration->m_calibration[i];
+            calibration.m_centerPulseWidth = GetChannelPulseWidth(i);
+            if (IsValidCalibration(calibration))
+            {
+                m_Configuration->m_calibratedChannels |= 1 << i;
+            }
+        }
+
+        UpdateGains(GetProfile());
+    }
+
+    static bool IsValidProfile(const Configuration& config)
+    {
+        if (config.m_version != Configuration::version)
+            return false;
+
+        if (config.m_reportLayout >= ReportLayoutCount)
             return false;
 
-        if (m_Configuration.m_minSyncPulseWidth < Configuration::minSyncWidth ||
-            m_Configuration.m_minSyncPulseWidth > Configuration::maxSyncWidth)
+        if (config.m_minSyncPulseWidth < Configuration::minSyncWidth ||
+            config.m_minSyncPulseWidth > Configuration::maxSyncWidth)
             return false;
 
-        if (m_Configuration.m_centerChannelPulseWidth < Configuration::minChannelPulseWidth ||
-            m_Configuration.m_centerChannelPulseWidth > Configuration::maxChannelPulseWidth)
+        if (config.m_centerChannelPulseWidth < Configuration::minChannelPulseWidth ||
+            config.m_centerChannelPulseWidth > Configuration::maxChannelPulseWidth)
             return false;
 
-        if (m_Configuration.m_channelPulseWidthRange < 10 ||
-            m_Configuration.m_channelPulseWidthRange > Configuration::maxChannelPulseWidth)
+        // Narrower ranges need a gain beyond 16 bits to reach full deflection
+        if (config.m_channelPulseWidthRange < Configuration::minCalibrationRange ||
+            config.m_channelPulseWidthRange > Configuration::maxChannelPulseWidth)
             return false;
 
-        for (uint8_t i = 0; i < sizeof(m_Configuration.m_mapping); i++)
+        for (uint8_t i = 0; i < sizeof(config.m_mapping); i++)
         {
-            if (m_Configuration.m_mapping[i] >= Configuration::maxChannels)
+            if (config.m_mapping[i] >= Configuration::maxChannels)
             {
                 return false;
             }
         }
 
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            if ((config.m_calibratedChannels & (1 << i)) != 0 && !IsValidCalibration(config.m_calibration[i]))
+            {
+                return false;
+            }
+
+#if HIDRCJOY_CURVES
+            const ChannelCurve& curve = config.m_curves[i];
+            if (curve.m_expo > 100 || curve.m_rate > 100 || curve.m_curve > Configuration::maxCurves || curve.m_deadband > Configuration::maxDeadband)
+            {
+                return false;
+            }
+#endif
+        }
+
+#if HIDRCJOY_CURVES
+        for (uint8_t i = 0; i < Configuration::maxCurves; i++)
+        {
+            for (uint8_t j = 0; j < Configuration::curvePoints; j++)
+            {
+                if (config.m_customCurves[i][j] < -127)
+                {
+                    return false;
+                }
+            }
+        }
+#endif
+
         return true;
     }
 
-    void Update(uint32_t time)
+    // Called from the main loop with the time in us and the timer ticks of the same instant.
+    // Returns true if learning the calibration changed the configuration.
+    bool Update(uint32_t time, uint32_t ticks)
     {
+        bool changed = false;
+
         m_PpmReceiver.Update(time);
 #if HIDRCJOY_SRXL
         m_SrxlReceiver.Update(time);
+        UpdateSources();
+#endif
+
+        uint8_t channels = GetUpdatedChannels(time, ticks);
+        if (GetStatus() == NoSignal)
+        {
+            m_filterValid = false;
+        }
+        else if (channels != 0)
+        {
+            m_updateCounter++;
+            changed = UpdateFrame(channels);
+        }
+
+#if HIDRCJOY_UPSAMPLING
+        for (uint8_t i = 0; i < sourceCount; i++)
+        {
+            UpdatePrediction(m_frameTiming[i], time);
+        }
 #endif
+
+        return changed;
+    }
+
+    // Returns a counter, which is incremented whenever a complete frame was received
+    // by a receiver that at least one channel is taken from
+    uint8_t GetUpdateCounter() const
+    {
+        return m_updateCounter;
     }
 
+    // Returns the timer ticks of the last edge of the most recent PPM frame
+    uint32_t GetPpmFrameTicks() const
+    {
+        return m_ppmFrameTicks;
+    }
+
+#if HIDRCJOY_SRXL
     uint16_t GetChannelPulseWidth(uint8_t channel) const
     {
-        uint8_t index = m_Configuration.m_mapping[channel];
-        
-        if (m_PpmReceiver.IsDataAvailable())
+        uint8_t index = m_Configuration->m_mapping[channel];
+
+        if ((m_srxlSelected & (1 << channel)) != 0)
         {
-            return m_PpmReceiver.GetChannelPulseWidth(index);
+            return m_SrxlReceiver.IsDataAvailable() ? m_SrxlReceiver.GetChannelPulseWidth(index) : 0;
         }
-#if HIDRCJOY_SRXL
-        else if (m_SrxlReceiver.IsDataAvailable())
+        else
         {
-            return m_SrxlReceiver.GetChannelPulseWidth(index);
+            return m_PpmReceiver.IsDataAvailable() ? m_PpmReceiver.GetChannelPulseWidth(index) : 0;
+        }
+    }
+#else
+    uint16_t GetChannelPulseWidth(uint8_t channel) const
+    {
+        uint8_t index = m_Configuration->m_mapping[channel];
+
+        if (m_PpmReceiver.IsDataAvailable())
+        {
+            return m_PpmReceiver.GetChannelPulseWidth(index);
         }
-#endif
         else
         {
             return 0;
         }
     }
+#endif
 
+    // Returns the source of the first channel, or NoSignal if nothing is received
     uint8_t GetStatus() const
     {
+#if HIDRCJOY_SRXL
+        if (!m_PpmReceiver.IsDataAvailable() && !m_SrxlReceiver.IsDataAvailable())
+        {
+            return NoSignal;
+        }
+        else
+        {
+            return (m_srxlSelected & 1) != 0 ? SrxlSignal : PpmSignal;
+        }
+#else
         if (m_PpmReceiver.IsDataAvailable())
         {
             return PpmSignal;
         }
-#if HIDRCJOY_SRXL
-        else if (m_SrxlReceiver.IsDataAvailable())
+        else
         {
-            return SrxlSignal;
+            return NoSignal;
         }
 #endif
-        else
+    }
+
+#if HIDRCJOY_UPSAMPLING
+    // Returns true if the channel values are extrapolated between frames
+    bool IsUpsampling() const
+    {
+        return (m_Configuration->m_flags & Configuration::Upsampling) != 0 && m_filterValid;
+    }
+
+#if HIDRCJOY_MIXER
+    // Mixes the extrapolated values, which unlike the received ones change between frames
+    void UpdateUpsampledMixer()
+    {
+        if (m_Mixer.m_enabled && IsUpsampling())
         {
-            return NoSignal;
+            UpdateMixer();
         }
     }
+#endif
+#endif
+
+    // Returns the channel value in the range -32767..32767, with deadband and response curve applied
+    int16_t GetAxisValue(uint8_t channel) const
+    {
+#if HIDRCJOY_CURVES
+        return ApplyCurve(m_Configuration->m_curves[channel], ApplyDeadband(channel, GetLinearAxisValue(channel)));
+#else
+        return GetLinearAxisValue(channel);
+#endif
+    }
 
+    // Returns the mixed channel value in the range -32767..32767, without the response curve
+    int16_t GetLinearAxisValue(uint8_t channel) const
+    {
+#if HIDRCJOY_MIXER
+        if (m_Mixer.m_enabled)
+        {
+            return m_mixed[channel];
+        }
+#endif
+
+        return GetCalibratedValue(channel);
+    }
+
+    // Returns the channel value in the range 0..255
     uint8_t GetValue(uint8_t channel) const
     {
-        int16_t center = m_Configuration.m_centerChannelPulseWidth;
-        int16_t range = m_Configuration.m_channelPulseWidthRange;
-        int16_t value = Polarity(channel, (int16_t)GetChannelPulseWidth(channel) - center);
-        int32_t scaled = 128 + 128 * (int32_t)value / range;
-        return Saturate(scaled);
+        return 128 + (GetAxisValue(channel) >> 8);
+    }
+
+    // Returns the position of a switch channel, 0..1 or 0..2.
+    // The position only changes once the value is past the threshold by the hysteresis.
+    uint8_t GetSwitchPosition(uint8_t channel)
+    {
+        uint8_t positions = m_Configuration->GetSwitchPositions(channel);
+        uint8_t position = m_switchPosition[channel];
+        int16_t value = GetLinearAxisValue(channel);
+
+        if (position >= positions)
+        {
+            position = positions - 1;
+        }
+
+        while (position + 1 < positions && value > GetSwitchThreshold(positions, position) + switchHysteresis)
+        {
+            position++;
+        }
+
+        while (position > 0 && value < GetSwitchThreshold(positions, position - 1) - switchHysteresis)
+        {
+            position--;
+        }
+
+        m_switchPosition[channel] = position;
+        return position;
     }
 
 private:
-    int16_t Polarity(uint8_t channel, int16_t value) const
+    static const int16_t switchHysteresis = 4096;
+    static const uint8_t allChannels = (1 << MAX_CHANNELS) - 1;
+    static const uint8_t gainShift = 7;
+    static const uint8_t deadbandGainShift = 14;
+    static const uint8_t filterShift = 4; // fractional bits of the filtered pulse widths
+#if HIDRCJOY_PROFILES > 1
+    static const uint16_t minSelectPulseWidth = 1000;
+    static const uint16_t maxSelectPulseWidth = 2000;
+    static const uint16_t selectHysteresis = 25;
+#endif
+#if HIDRCJOY_SRXL
+    static const uint8_t sourceCount = 2; // PPM and SRXL
+#else
+    static const uint8_t sourceCount = 1;
+#endif
+#if HIDRCJOY_UPSAMPLING
+    static const int16_t maxPredictionStep = 200 << filterShift;
+    static const uint16_t maxFramePeriod = 50000;
+#endif
+
+    // Multiplying by percentFactor and shifting by percentShift divides by about 100
+    static const uint16_t percentFactor = 655;
+    static const uint8_t percentShift = 16;
+
+#if HIDRCJOY_UPSAMPLING
+    struct FrameTiming
+    {
+        uint32_t m_frameTime;
+        uint16_t m_framePeriod;
+        uint32_t m_framePeriodInverse;
+        uint16_t m_predictionFraction;
+    };
+#endif
+
+    static void LoadDefaultProfile(Configuration& config)
     {
-        return (m_Configuration.m_polarity & (1 << channel)) == 0 ? value : -value;
+        config.m_version = Configuration::version;
+        config.m_flags = 0;
+        config.m_reportLayout = Axes7Layout;
+        config.m_minSyncPulseWidth = 3500;
+        config.m_centerChannelPulseWidth = 1500;
+        config.m_channelPulseWidthRange = 550;
+        config.m_polarity = 0;
+        config.m_twoPositionSwitches = 0;
+        config.m_threePositionSwitches = 0;
+        config.m_calibratedChannels = 0;
+#if HIDRCJOY_FILTERS
+        config.m_medianChannels = 0;
+#endif
+#if HIDRCJOY_SRXL
+        config.m_srxlChannels = 0;
+#endif
+
+        for (uint8_t i = 0; i < sizeof(config.m_mapping); i++)
+        {
+            config.m_mapping[i] = i;
+        }
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            ChannelCalibration& calibration = config.m_calibration[i];
+            calibration.m_minPulseWidth = config.m_centerChannelPulseWidth - config.m_channelPulseWidthRange;
+            calibration.m_centerPulseWidth = config.m_centerChannelPulseWidth;
+            calibration.m_maxPulseWidth = config.m_centerChannelPulseWidth + config.m_channelPulseWidthRange;
+
+#if HIDRCJOY_CURVES
+            ChannelCurve& curve = config.m_curves[i];
+            curve.m_expo = 0;
+            curve.m_rate = 100;
+            curve.m_curve = 0;
+            curve.m_deadband = 0;
+#endif
+
+#if HIDRCJOY_FILTERS
+            ChannelFilter& filter = config.m_filters[i];
+            filter.m_minAlpha = 0;
+            filter.m_beta = 0;
+#endif
+        }
+
+#if HIDRCJOY_CURVES
+        for (uint8_t i = 0; i < Configuration::maxCurves; i++)
+        {
+            for (uint8_t j = 0; j < Configuration::curvePoints; j++)
+            {
+                config.m_customCurves[i][j] = (int16_t)j * 254 / (Configuration::curvePoints - 1) - 127;
+            }
+        }
+#endif
     }
 
-    uint8_t Saturate(int32_t value) const
+    static bool IsValidCalibration(const ChannelCalibration& calibration)
     {
-        if (value < 0)
+        return calibration.m_minPulseWidth >= Configuration::minChannelPulseWidth &&
+            calibration.m_maxPulseWidth <= Configuration::maxChannelPulseWidth &&
+            calibration.m_centerPulseWidth >= calibration.m_minPulseWidth + Configuration::minCalibrationRange &&
+            calibration.m_centerPulseWidth + Configuration::minCalibrationRange <= calibration.m_maxPulseWidth;
+    }
+
+    // Returns true if the patched bytes overlap the field at 'first' with the given size
+    static bool IsPatched(uint8_t offset, uint8_t length, uint8_t first, uint8_t size)
+    {
+        return offset < first + size && first < offset + length;
+    }
+
+    // Returns the fixed-point factor scaling a half range of the given width to 32767
+    static uint16_t GetGain(uint16_t range)
+    {
+        uint32_t gain = ((uint32_t)32767 << gainShift) / (range > 0 ? range : 1);
+        return gain < 0xFFFF ? gain : 0xFFFF;
+    }
+
+    // Precomputes center and gains of a profile, so GetAxisValue does not need to divide
+    void UpdateGains(uint8_t profile)
+    {
+        const Configuration& config = m_Profiles[profile];
+        ProfileGains& gains = m_profileGains[profile];
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            if ((config.m_calibratedChannels & (1 << i)) != 0)
+            {
+                const ChannelCalibration& calibration = config.m_calibration[i];
+                gains.m_center[i] = calibration.m_centerPulseWidth;
+                gains.m_gain[i][0] = GetGain(calibration.m_centerPulseWidth - calibration.m_minPulseWidth);
+                gains.m_gain[i][1] = GetGain(calibration.m_maxPulseWidth - calibration.m_centerPulseWidth);
+            }
+            else
+            {
+                gains.m_center[i] = config.m_centerChannelPulseWidth;
+                gains.m_gain[i][0] = GetGain(config.m_channelPulseWidthRange);
+                gains.m_gain[i][1] = gains.m_gain[i][0];
+            }
+
+#if HIDRCJOY_CURVES
+            // Stretches the range outside the deadband back to 0..32767
+            uint16_t band = (uint16_t)config.m_curves[i].m_deadband << 7;
+            gains.m_deadbandGain[i] = ((uint32_t)32767 << deadbandGainShift) / (32767 - band);
+#endif
+        }
+    }
+
+    void UpdateReceiverConfiguration()
+    {
+        m_PpmReceiver.SetConfiguration(m_Configuration->m_minSyncPulseWidth, (m_Configuration->m_flags & Configuration::Flags::InvertedSignal) != 0);
+    }
+
+#if HIDRCJOY_PROFILES > 1
+    // Returns the pulse width between the profiles 'profile' and 'profile + 1',
+    // which divide the range of the selection channel into equal bands
+    static uint16_t GetProfileThreshold(uint8_t profile)
+    {
+        return minSelectPulseWidth + (uint16_t)(profile + 1) * (maxSelectPulseWidth - minSelectPulseWidth) / HIDRCJOY_PROFILES;
+    }
+
+    // Returns the position of the selection channel, moving from the given position with
+    // hysteresis, or 0xFF if there is no selection channel or it is not received
+    uint8_t GetSelectPosition(uint8_t position) const
+    {
+        uint8_t channel = m_ProfileConfiguration.m_selectChannel;
+        if (channel >= Configuration::maxChannels)
+            return 0xFF;
+
+        uint16_t pulseWidth = GetChannelPulseWidth(channel);
+        if (pulseWidth < Configuration::minChannelPulseWidth || pulseWidth > Configuration::maxChannelPulseWidth)
+            return 0xFF;
+
+        if (position >= HIDRCJOY_PROFILES)
+        {
+            position = 0;
+        }
+
+        while (position + 1 < HIDRCJOY_PROFILES && pulseWidth > GetProfileThreshold(position) + selectHysteresis)
+        {
+            position++;
+        }
+
+        while (position > 0 && pulseWidth < GetProfileThreshold(position - 1) - selectHysteresis)
+        {
+            position--;
+        }
+
+        return position;
+    }
+
+    // Selects the profile from the position of the selection channel. A host selection
+    // stays in effect until the channel moves to another position.
+    void UpdateProfileSelection()
+    {
+        // The calibration is learned into the active profile
+        if (m_calibrating)
+            return;
+
+        uint8_t position = GetSelectPosition(m_selectPosition);
+        if (position != 0xFF && position != m_selectPosition)
+        {
+            m_selectPosition = position;
+            SelectProfile(position);
+        }
+    }
+#endif
+
+    // Returns the channel value in the range -32767..32767, before mixing
+    int16_t GetCalibratedValue(uint8_t channel) const
+    {
+        int16_t value = (int16_t)GetFilteredPulseWidth(channel) - (int16_t)m_gains->m_center[channel];
+        int32_t scaled = ((int32_t)value * m_gains->m_gain[channel][value < 0 ? 0 : 1]) >> gainShift;
+        return Polarity(channel, Saturate(scaled));
+    }
+
+#if HIDRCJOY_CURVES
+    // Records which channels are inside their deadband. Once inside, the value has to
+    // leave the band by the hysteresis to move again. Called once per frame.
+    void UpdateDeadbands()
+    {
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            int16_t band = (int16_t)m_Configuration->m_curves[i].m_deadband << 7;
+            int16_t value = GetLinearAxisValue(i);
+            int16_t magnitude = value < 0 ? -value : value;
+            uint8_t mask = 1 << i;
+
+            if (magnitude <= band)
+            {
+                m_inDeadband |= mask;
+            }
+            else if (magnitude > band + (band >> 2))
+            {
+                m_inDeadband &= ~mask;
+            }
+        }
+    }
+
+    // Returns 0 inside the deadband, and rescales the rest to the full range
+    int16_t ApplyDeadband(uint8_t channel, int16_t value) const
+    {
+        int16_t band = (int16_t)m_Configuration->m_curves[channel].m_deadband << 7;
+        if (band == 0)
+            return value;
+
+        if ((m_inDeadband & (1 << channel)) != 0)
+            return 0;
+
+        int16_t magnitude = value < 0 ? -value : value;
+
+        int16_t scaled = Saturate(((int32_t)(magnitude - band) * m_gains->m_deadbandGain[channel]) >> deadbandGainShift);
+        return value < 0 ? -scaled : scaled;
+    }
+
+    int16_t ApplyCurve(const ChannelCurve& curve, int16_t value) const
+    {
+        if (curve.m_curve != 0)
+        {
+            value = InterpolateCustomCurve(m_Configuration->m_customCurves[curve.m_curve - 1], value);
+        }
+        else if (curve.m_expo != 0)
+        {
+            int16_t magnitude = value < 0 ? -value : value;
+            int16_t expo = magnitude + (int16_t)(((int32_t)(InterpolateExpoTable(magnitude) - magnitude) * curve.m_expo * percentFactor) >> percentShift);
+            value = value < 0 ? -expo : expo;
+        }
+
+        if (curve.m_rate < 100)
+        {
+            value = ((int32_t)value * curve.m_rate * percentFactor) >> percentShift;
+        }
+
+        return value;
+    }
+
+    // Interpolates the expo table for the value 0..32767
+    static int16_t InterpolateExpoTable(int16_t value)
+    {
+        uint8_t index = value >> 11;
+        int16_t fraction = value & 0x07FF;
+        int16_t y0 = pgm_read_word(&g_ExpoTable[index]);
+        int16_t y1 = pgm_read_word(&g_ExpoTable[index + 1]);
+        return y0 + (int16_t)((((int32_t)y1 - y0) * fraction) >> 11);
+    }
+
+    // Interpolates a custom curve for the value -32767..32767
+    int16_t InterpolateCustomCurve(const int8_t* points, int16_t value) const
+    {
+        // Curve points are scaled by 258 to cover -32766..32766
+        uint16_t position = (uint16_t)(value + 32767);
+        uint8_t index = position >> 13;
+        int16_t fraction = position & 0x1FFF;
+        int32_t y0 = (int32_t)points[index] * 258;
+        int32_t y1 = (int32_t)points[index + 1] * 258;
+        return Saturate(y0 + (((y1 - y0) * fraction) >> 13));
+    }
+#endif
+
+    uint16_t GetFilteredPulseWidth(uint8_t channel) const
+    {
+#if HIDRCJOY_UPSAMPLING
+        if (IsUpsampling())
+        {
+            return GetPredictedPulseWidth(channel);
+        }
+#endif
+
+#if HIDRCJOY_FILTERS
+        if (m_Configuration->m_filters[channel].m_minAlpha != 0 || (m_Configuration->m_medianChannels & (1 << channel)) != 0)
+        {
+            return (m_filtered[channel] + (1 << (filterShift - 1))) >> filterShift;
+        }
+#endif
+
+        return GetChannelPulseWidth(channel);
+    }
+
+#if HIDRCJOY_UPSAMPLING
+    // Extrapolates the movement of the last two frames up to one frame period ahead.
+    // Jumps larger than maxPredictionStep are steps such as switches, which are not extrapolated.
+    uint16_t GetPredictedPulseWidth(uint8_t channel) const
+    {
+        int32_t current = m_filtered[channel];
+        int32_t delta = current - m_previousFiltered[channel];
+        if (delta > -maxPredictionStep && delta < maxPredictionStep)
+        {
+            current += (delta * m_frameTiming[GetSource(channel)].m_predictionFraction) >> 8;
+        }
+
+        return current > 0 ? (current + (1 << (filterShift - 1))) >> filterShift : 0;
+    }
+
+    // Updates the fraction of the frame period, 0..256, elapsed since the last frame
+    static void UpdatePrediction(FrameTiming& timing, uint32_t time)
+    {
+        uint32_t elapsed = time - timing.m_frameTime;
+        if (elapsed >= timing.m_framePeriod)
+        {
+            timing.m_predictionFraction = 256;
+        }
+        else
+        {
+            timing.m_predictionFraction = (elapsed * timing.m_framePeriodInverse) >> 16;
+        }
+    }
+
+    // Called once per frame of a receiver, only the division is done per frame,
+    // the prediction itself multiplies
+    static void UpdateFrameTiming(FrameTiming& timing, uint32_t time)
+    {
+        uint32_t period = time - timing.m_frameTime;
+        timing.m_framePeriod = period < maxFramePeriod ? period : maxFramePeriod;
+        timing.m_framePeriodInverse = ((uint32_t)256 << 16) / (timing.m_framePeriod > 0 ? timing.m_framePeriod : 1);
+        timing.m_frameTime = time;
+        timing.m_predictionFraction = 0;
+    }
+#endif
+
+    // Returns the receiver index of the channel, 0 for PPM, 1 for SRXL
+    uint8_t GetSource(uint8_t channel) const
+    {
+#if HIDRCJOY_SRXL
+        return (m_srxlSelected >> channel) & 1;
+#else
+        return 0;
+#endif
+    }
+
+    // Returns the channels whose receiver completed a frame since the last call
+    uint8_t GetUpdatedChannels(uint32_t time, uint32_t ticks)
+    {
+        uint8_t channels = 0;
+
+        uint8_t ppmCounter = m_PpmReceiver.GetUpdateCounter();
+        if (ppmCounter != m_sourceCounter[0])
+        {
+            m_sourceCounter[0] = ppmCounter;
+
+            // The 16-bit capture time wraps after 32 ms with timer1, so it is extended
+            // once per frame, shortly after the frame was received
+            m_ppmFrameTicks = Timer::ExtendTicks(ticks, m_PpmReceiver.GetFrameTime());
+#if HIDRCJOY_UPSAMPLING
+            UpdateFrameTiming(m_frameTiming[0], time);
+#endif
+#if HIDRCJOY_SRXL
+            channels |= ~m_srxlSelected & allChannels;
+#else
+            channels = allChannels;
+#endif
+        }
+
+#if HIDRCJOY_SRXL
+        uint8_t srxlCounter = m_SrxlReceiver.GetUpdateCounter();
+        if (srxlCounter != m_sourceCounter[1])
+        {
+            m_sourceCounter[1] = srxlCounter;
+#if HIDRCJOY_UPSAMPLING
+            UpdateFrameTiming(m_frameTiming[1], time);
+#endif
+            channels |= m_srxlSelected;
+        }
+#endif
+
+        return channels;
+    }
+
+#if HIDRCJOY_SRXL
+    // Selects the receiver of each channel: the preferred one if its frames arrive in time,
+    // else the other one if its frames arrive in time, else whichever still has data
+    void UpdateSources()
+    {
+        bool ppmCurrent = m_PpmReceiver.IsFrameCurrent();
+        bool srxlCurrent = m_SrxlReceiver.IsFrameCurrent();
+        bool ppmAvailable = m_PpmReceiver.IsDataAvailable();
+        bool srxlAvailable = m_SrxlReceiver.IsDataAvailable();
+
+        bool srxlIfPreferred = srxlCurrent || (!ppmCurrent && (srxlAvailable || !ppmAvailable));
+        bool srxlIfNotPreferred = !ppmCurrent && (srxlCurrent || !ppmAvailable);
+
+        m_srxlSelected = (srxlIfPreferred ? m_Configuration->m_srxlChannels : 0) |
+            (srxlIfNotPreferred ? ~m_Configuration->m_srxlChannels & allChannels : 0);
+    }
+#endif
+
+    // Called once per received frame with the channels taken from the receiver of the frame
+    bool UpdateFrame(uint8_t channels)
+    {
+        bool changed = false;
+
+#if HIDRCJOY_PROFILES > 1
+        // Before the filters, so the new profile applies to this frame already
+        UpdateProfileSelection();
+#endif
+
+#if HIDRCJOY_FILTERS
+        UpdateFilters(channels);
+#endif
+
+        if (m_calibrating)
+        {
+            changed = UpdateCalibration();
+        }
+
+#if HIDRCJOY_MIXER
+        if (m_Mixer.m_enabled)
         {
+            UpdateMixer();
+        }
+#endif
+
+#if HIDRCJOY_CURVES
+        UpdateDeadbands();
+#endif
+        return changed;
+    }
+
+#if HIDRCJOY_MIXER
+    void UpdateMixer()
+    {
+        int16_t values[MAX_CHANNELS];
+        for (uint8_t j = 0; j < Configuration::maxChannels; j++)
+        {
+            values[j] = GetCalibratedValue(j);
+        }
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            int32_t sum = 0;
+            for (uint8_t j = 0; j < Configuration::maxChannels; j++)
+            {
+                sum += (int32_t)values[j] * m_Mixer.m_matrix[i][j];
+            }
+
+            m_mixed[i] = Saturate(sum >> 8);
+        }
+    }
+#endif
+
+#if HIDRCJOY_FILTERS
+    // Returns max(min(a, b), min(max(a, b), c)), which compiles to compares and moves
+    static uint16_t Median(uint16_t a, uint16_t b, uint16_t c)
+    {
+        uint16_t low = a < b ? a : b;
+        uint16_t high = a < b ? b : a;
+        uint16_t middle = high < c ? high : c;
+        return low > middle ? low : middle;
+    }
+
+    // Removes single-frame spikes with the median of the last three pulse widths,
+    // then moves the filtered value toward the new sample. Small changes such as capture
+    // jitter get a small weight, fast stick movements pass with little lag.
+    // Only the given channels are updated, unless the filters are initialized.
+    void UpdateFilters(uint8_t channels)
+    {
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            if (m_filterValid && (channels & (1 << i)) == 0)
+                continue;
+
+            const ChannelFilter& filter = m_Configuration->m_filters[i];
+            uint16_t pulseWidth = GetChannelPulseWidth(i);
+
+            if (!m_filterValid)
+            {
+                m_history[i][0] = pulseWidth;
+                m_history[i][1] = pulseWidth;
+            }
+
+            uint16_t median = Median(m_history[i][0], m_history[i][1], pulseWidth);
+            m_history[i][0] = m_history[i][1];
+            m_history[i][1] = pulseWidth;
+
+            if ((m_Configuration->m_medianChannels & (1 << i)) != 0)
+            {
+                pulseWidth = median;
+            }
+
+            // Pulses longer than a channel can be, but shorter than the sync pulse, would wrap
+            if (pulseWidth > Configuration::maxChannelPulseWidth)
+            {
+                pulseWidth = Configuration::maxChannelPulseWidth;
+            }
+
+            uint16_t sample = pulseWidth << filterShift;
+
+#if HIDRCJOY_UPSAMPLING
+            m_previousFiltered[i] = m_filterValid ? m_filtered[i] : sample;
+#endif
+
+            if (!m_filterValid || filter.m_minAlpha == 0)
+            {
+                m_filtered[i] = sample;
+                continue;
+            }
+
+            int32_t delta = (int32_t)sample - m_filtered[i];
+            uint16_t distance = (delta < 0 ? -delta : delta) >> filterShift;
+            if (distance > 255)
+            {
+                distance = 255;
+            }
+
+            uint16_t alpha = filter.m_minAlpha + filter.m_beta * distance;
+            if (alpha >= 256)
+            {
+                m_filtered[i] = sample;
+            }
+            else
+            {
+                // Rounds the step symmetrically, so the filter settles on the sample from both sides
+                int32_t step = delta * alpha;
+                m_filtered[i] += (int16_t)(step < 0 ? -((-step + 128) >> 8) : (step + 128) >> 8);
+            }
+        }
+
+        m_filterValid = true;
+    }
+#endif
+
+    // Records the channel extremes, returns true if any changed
+    bool UpdateCalibration()
+    {
+        bool changed = false;
+
+        for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+        {
+            uint16_t pulseWidth = GetChannelPulseWidth(i);
+            if (pulseWidth < Configuration::minChannelPulseWidth || pulseWidth > Configuration::maxChannelPulseWidth)
+                continue;
+
+            ChannelCalibration& calibration = m_Configuration->m_calibration[i];
+            if (pulseWidth < calibration.m_minPulseWidth)
+            {
+                calibration.m_minPulseWidth = pulseWidth;
+                changed = true;
+            }
+
+            if (pulseWidth > calibration.m_maxPulseWidth)
+            {
+                calibration.m_maxPulseWidth = pulseWidth;
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    // Returns the threshold between the switch positions 'position' and 'position + 1'
+    static int16_t GetSwitchThreshold(uint8_t positions, uint8_t position)
+    {
+        if (positions == 2)
             return 0;
+        else
+            return position == 0 ? -16384 : 16384;
+    }
+
+    int16_t Polarity(uint8_t channel, int16_t value) const
+    {
+        return (m_Configuration->m_polarity & (1 << channel)) == 0 ? value : -value;
+    }
+
+    int16_t Saturate(int32_t value) const
+    {
+        if (value < -32767)
+        {
+            return -32767;
         }
-        else if (value > 255)
+        else if (value > 32767)
         {
-            return 255;
+            return 32767;
         }
         else
         {
@@ -149,8 +1117,53 @@ private:
         }
     }
 
+    struct ProfileGains
+    {
+        uint16_t m_center[MAX_CHANNELS];
+        uint16_t m_gain[MAX_CHANNELS][2]; // below and above center
+#if HIDRCJOY_CURVES
+        uint16_t m_deadbandGain[MAX_CHANNELS];
+#endif
+    };
+
+    uint8_t m_switchPosition[MAX_CHANNELS] = {};
+    ProfileGains m_profileGains[HIDRCJOY_PROFILES];
+    ProfileGains* m_gains = &m_profileGains[0];
+#if HIDRCJOY_PROFILES > 1
+    uint8_t m_selectPosition = 0xFF; // position of the selection channel, 0xFF if unknown
+#endif
+#if HIDRCJOY_CURVES
+    uint8_t m_inDeadband = 0;
+#endif
+    bool m_calibrating = false;
+#if HIDRCJOY_SRXL
+    uint8_t m_srxlSelected = 0; // channels currently taken from SRXL
+#endif
+    uint8_t m_updateCounter = 0;
+    uint8_t m_sourceCounter[sourceCount] = {}; // last seen update counter of each receiver
+    uint32_t m_ppmFrameTicks = 0;
+#if HIDRCJOY_FILTERS
+    uint16_t m_filtered[MAX_CHANNELS]; // pulse widths in 1/16 us
+    uint16_t m_history[MAX_CHANNELS][2]; // last two raw pulse widths
+#endif
+#if HIDRCJOY_UPSAMPLING
+    uint16_t m_previousFiltered[MAX_CHANNELS];
+    FrameTiming m_frameTiming[sourceCount] = {}; // channels are extrapolated with the timing of their receiver
+#endif
+    bool m_filterValid = false;
+#if HIDRCJOY_MIXER
+    int16_t m_mixed[MAX_CHANNELS];
+#endif
+
 public:
-    Configuration m_Configuration;
+    Configuration m_Profiles[HIDRCJOY_PROFILES];
+    Configuration* m_Configuration = &m_Profiles[0]; // the active profile
+#if HIDRCJOY_PROFILES > 1
+    ProfileConfiguration m_ProfileConfiguration;
+#endif
+#if HIDRCJOY_MIXER
+    MixerConfiguration m_Mixer;
+#endif
     PpmReceiver m_PpmReceiver;
 #if HIDRCJOY_SRXL
     SrxlReceiver m_SrxlReceiver;
@@ -31,6 +31,7 @@ class SrxlReceiver
         uint8_t m_data[1 + 16 * 2 + 2] = {};
         uint8_t m_status = 0;
         uint8_t m_position = 0;
+        uint32_t m_time = 0;
     };
 
 public:
@@ -69,10 +70,16 @@ public:
         }
         else
         {
+            uint32_t period = time - m_lastUpdateTime;
+            m_framePeriod = period < 0xFFFF ? period : 0xFFFF;
             m_lastUpdateCount = updateCounter;
             m_lastUpdateTime = time;
             m_isDataAvailable = true;
         }
+
+        // A frame overdue by half a frame period counts as missing, which
+        // allows the receiver to fail over long before the signal timeout
+        m_isFrameCurrent = m_isDataAvailable && time - m_lastUpdateTime <= m_framePeriod + m_framePeriod / 2;
     }
 
     bool IsDataAvailable() const
@@ -80,6 +87,23 @@ public:
         return m_isDataAvailable;
     }
 
+    // Returns true if the last frame arrived in time
+    bool IsFrameCurrent() const
+    {
+        return m_isFrameCurrent;
+    }
+
+    uint8_t GetUpdateCounter() const
+    {
+        return m_updateCounter;
+    }
+
+    // Returns the time in us of the last byte of the most recent frame
+    uint32_t GetFrameTime() const
+    {
+        return m_frameTime;
+    }
+
     uint16_t GetChannelPulseWidth(uint8_t channel) const
     {
         const Frame& frame = GetReceivedFrame();
@@ -117,6 +141,7 @@ public:
 
             if (frame.m_position >= sizeof(frame.m_data))
             {
+                frame.m_time = time;
                 frame.m_status = Ready;
                 m_frameIndex = !m_frameIndex;
             }
@@ -151,6 +176,7 @@ private:
                 uint16_t expectedCrc = GetUInt16(frame.m_data, payloadLength);
                 if (CalculateCrc16(frame.m_data, payloadLength) == expectedCrc)
                 {
+                    m_frameTime = frame.m_time;
                     m_updateCounter++;
                     frame.m_status = Ok;
                 }
@@ -218,7 +244,10 @@ private:
     Frame m_frame[2];
     uint8_t m_frameIndex = 0;
     uint8_t m_updateCounter = 0;
+    uint32_t m_frameTime = 0;
     uint8_t m_lastUpdateCount = 0;
     uint32_t m_lastUpdateTime = 0;
     bool m_isDataAvailable = false;
+    uint16_t m_framePeriod = 0;
+    bool m_isFrameCurrent = false;
 };
@@ -6,18 +6,33 @@
 #pragma once
 #include <stdint.h>
 #include <avr/io.h>
+#include "Board.h"
 
 /////////////////////////////////////////////////////////////////////////////
 
 class Timer
 {
+    static const uint8_t prescaler = Board::timerPrescaler;
+
+    // Clock select bits of the prescaler, which timer0 and timer1 encode the same way
+    static const uint8_t clockSelect = prescaler == 1 ? 1 : prescaler == 8 ? 2 : prescaler == 64 ? 3 : 0;
+    static_assert(clockSelect != 0, "Unsupported timer prescaler");
+
 public:
     void Initialize()
     {
-        // Use timer0 Fast PWM, clk/64
+#if HIDRCJOY_TIMER1
+        // Use timer1 normal mode, shared with the input capture unit
+        TCCR1A = 0;
+        TCCR1B = clockSelect;
+
+        // Enable timer1 overflow interrupt
+        TIMSK1 = _BV(TOIE1);
+#else
+        // Use timer0 Fast PWM
         GTCCR = 0;
         TCCR0A = _BV(WGM01) | _BV(WGM00);
-        TCCR0B = _BV(CS01) | _BV(CS00);
+        TCCR0B = clockSelect;
 
         // Enable timer0 overflow interrupt
 #if defined (TIMSK)
@@ -26,6 +41,7 @@ public:
         TIMSK0 = _BV(TOIE0);
 #else
 #error Unsupported architecture
+#endif
 #endif
     }
 
@@ -36,7 +52,7 @@ public:
 
     static uint32_t GetFrequency()
     {
-        return F_CPU / 64;
+        return F_CPU / prescaler;
     }
 
     uint32_t GetMicros() const
@@ -53,9 +69,23 @@ public:
         return ticks;
     }
 
+    // Extends a 16-bit timestamp to the full tick count, which is only correct for
+    // timestamps less than 65536 ticks before 'now'
+    static uint32_t ExtendTicks(uint32_t now, uint16_t ticks)
+    {
+        return now - static_cast<uint16_t>(static_cast<uint16_t>(now) - ticks);
+    }
+
     uint32_t GetTicksNoCli() const
     {
         uint32_t overflows = m_overflows;
+#if HIDRCJOY_TIMER1
+        uint16_t ticks = TCNT1;
+        if ((TIFR1 & _BV(TOV1)) && ticks < 0x8000)
+            overflows++;
+
+        return (overflows << 16) + ticks;
+#else
         uint8_t ticks = TCNT0;
 #if defined (TIFR)
         if ((TIFR & _BV(TOV0)) && ticks < 255)
@@ -68,16 +98,17 @@ public:
 #endif
 
         return (overflows << 8) + ticks;
+#endif
     }
 
     static uint32_t TicksToUs(uint32_t value)
     {
-        return value * (64 * 2) / (2 * F_CPU / 1000000);
+        return value * (prescaler * 2) / (2 * F_CPU / 1000000);
     }
 
     static uint32_t UsToTicks(uint32_t value)
     {
-        return value * (2 * F_CPU / 1000000) / (64 * 2);
+        return value * (2 * F_CPU / 1000000) / (prescaler * 2);
     }
 
 private:
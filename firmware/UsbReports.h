@@ -20,6 +20,32 @@ enum ReportIds
     ReadConfigurationFromEepromId,
     WriteConfigurationToEepromId,
     JumpToBootloaderId,
+    UsbReport16Id,
+    UsbReport16Part1Id,
+    UsbReport16Part2Id,
+    UsbReport16Part3Id,
+    UsbTimingReportId,
+    UsbDiagnosticsPart1Id,
+    UsbDiagnosticsPart2Id,
+    UsbDiagnosticsPart3Id,
+    DiagnosticsControlId,
+    UsbButtonReportId,
+    UsbReport4Id,
+    CalibrationControlId,
+    MixerReportId,
+    EepromStatusId,
+    ProfileReportId,
+    ConfigurationPatchId,
+};
+
+// Input report layouts, selected by Configuration::m_reportLayout
+enum ReportLayouts
+{
+    Axes7Layout, // 7 8-bit axes
+    Axes4Layout, // 4 8-bit axes
+    Axes16Layout, // 7 16-bit axes
+    ButtonsLayout, // 5 8-bit axes and switch channels as buttons
+    ReportLayoutCount,
 };
 
 enum Status
@@ -29,6 +55,9 @@ enum Status
     SrxlSignal,
 };
 
+// Reports are byte-packed on the AVR, so use the same layout in the tool
+#pragma pack(push, 1)
+
 struct UsbReport
 {
     uint8_t m_reportId;
@@ -39,9 +68,118 @@ struct UsbReport
 static_assert(sizeof(UsbReport) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
 #endif
 
+struct UsbReport4
+{
+    uint8_t m_reportId;
+    uint8_t m_value[4];
+};
+
+// Axis channels followed by switch channels packed as buttons, one button per
+// two-position switch and two buttons (low, high) per three-position switch
+#define USB_BUTTON_REPORT_AXES 5
+
+struct UsbButtonReport
+{
+    uint8_t m_reportId;
+    uint8_t m_value[USB_BUTTON_REPORT_AXES];
+    uint16_t m_buttons;
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(UsbButtonReport) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
+static_assert(MAX_CHANNELS * 2 <= 16, "Not enough buttons for all switch channels");
+#endif
+
+// 16-bit axes, sent as a single report by full-speed devices
+struct UsbReport16
+{
+    uint8_t m_reportId;
+    int16_t m_value[MAX_CHANNELS];
+};
+
+// 16-bit axes, split into multiple reports by low-speed devices
+#define USB_REPORT16_PART_CHANNELS 3
+#define USB_REPORT16_PARTS ((MAX_CHANNELS + USB_REPORT16_PART_CHANNELS - 1) / USB_REPORT16_PART_CHANNELS)
+
+struct UsbReport16Part
+{
+    uint8_t m_reportId;
+    int16_t m_value[USB_REPORT16_PART_CHANNELS];
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(UsbReport16Part) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
+static_assert(UsbReport16Part1Id + USB_REPORT16_PARTS - 1 == UsbReport16Part3Id, "Report IDs do not match the number of report parts");
+#endif
+
 struct UsbEnhancedReport
 {
     uint8_t m_reportId;
     uint8_t m_status;
     uint16_t m_channelPulseWidth[MAX_CHANNELS];
 };
+
+// Sent after each joystick report, if enabled by Configuration::TimingReports
+struct UsbTimingReport
+{
+    uint8_t m_reportId;
+    uint8_t m_sequence;     // Frame counter of the active receiver
+    uint16_t m_frameTime;   // Low word of the time in us when the frame was completed
+    uint32_t m_sendTime;    // Time in us when the joystick report was queued
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(UsbTimingReport) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
+#endif
+
+// Raw pulse widths, streamed in parts for each frame while enabled by DiagnosticsControlId
+#define USB_DIAGNOSTICS_PART_CHANNELS 3
+#define USB_DIAGNOSTICS_PARTS ((MAX_CHANNELS + USB_DIAGNOSTICS_PART_CHANNELS - 1) / USB_DIAGNOSTICS_PART_CHANNELS)
+
+struct UsbDiagnosticsReport
+{
+    uint8_t m_reportId;
+    uint8_t m_status;
+    uint16_t m_channelPulseWidth[USB_DIAGNOSTICS_PART_CHANNELS];
+};
+
+struct UsbDiagnosticsControlReport
+{
+    uint8_t m_reportId;
+    uint8_t m_enable;
+};
+
+// Starts the calibration learn mode, or ends it and applies the learned endpoints
+struct UsbCalibrationControlReport
+{
+    uint8_t m_reportId;
+    uint8_t m_learn;
+};
+
+// Progress of the background write started by WriteConfigurationToEepromId
+struct UsbEepromStatusReport
+{
+    uint8_t m_reportId;
+    uint8_t m_busy;
+    uint16_t m_bytesRemaining;
+};
+
+// Writes m_length bytes at m_offset of the active configuration, so the host can change
+// a single field. The report fits into one 8-byte packet, so it is applied at once.
+#define USB_CONFIGURATION_PATCH_SIZE 5
+
+struct UsbConfigurationPatchReport
+{
+    uint8_t m_reportId;
+    uint8_t m_offset;
+    uint8_t m_length;
+    uint8_t m_data[USB_CONFIGURATION_PATCH_SIZE];
+};
+
+#ifdef __cplusplus
+static_assert(sizeof(UsbConfigurationPatchReport) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
+static_assert(sizeof(UsbDiagnosticsReport) <= 8, "Report size for low-speed devices may not exceed 8 bytes");
+static_assert(UsbDiagnosticsPart1Id + USB_DIAGNOSTICS_PARTS - 1 == UsbDiagnosticsPart3Id, "Report IDs do not match the number of report parts");
+#endif
+
+#pragma pack(pop)
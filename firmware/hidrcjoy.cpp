@@ -8,12 +8,14 @@
 #include <avr/eeprom.h>
 #include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/sleep.h>
 #include <avr/wdt.h>
 #include <util/delay.h>
 
 #if defined(USB_V_USB)
 extern "C" {
 #include "usbdrv/usbdrv.h"
+#include "Descriptors.h"
 }
 #elif defined(USB_LUFA)
 #include <LUFA/Drivers/USB/USB.h>
@@ -24,67 +26,286 @@ extern "C" {
 
 #define COUNTOF(array) (sizeof(array) / sizeof(array[0]))
 
-#if defined (BOARD_Digispark)
-#define HIDRCJOY_SRXL 0
-#define PPM_SIGNAL_PIN PINB
-#define PPM_SIGNAL_PORT PORTB
-#define PPM_SIGNAL 2 // Pin 2
-#define LED_STATUS_DDR DDRB
-#define LED_STATUS_PORT PORTB
-#define LED_STATUS 1 // Pin 1 (built-in LED)
-#elif defined (BOARD_DigisparkPro)
-#define HIDRCJOY_SRXL 0
-#define PPM_SIGNAL_PIN PINA
-#define PPM_SIGNAL_PORT PORTA
-#define PPM_SIGNAL 4
-#define LED_STATUS_DDR DDRB
-#define LED_STATUS_PORT PORTB
-#define LED_STATUS 1 // Pin 1 (built-in LED)
-#elif defined (BOARD_FabISP)
-#define HIDRCJOY_SRXL 0
-#define PPM_SIGNAL_PIN PINA
-#define PPM_SIGNAL_PORT PORTA
-#define PPM_SIGNAL 6 // ADC6/MOSI
-#define LED_STATUS_DDR DDRA
-#define LED_STATUS_PORT PORTA
-#define LED_STATUS 5 // PA5/MISO
-#elif defined (BOARD_ProMicro)
-#define HIDRCJOY_SRXL 1
-#define PPM_SIGNAL_PIN PIND
-#define PPM_SIGNAL_PORT PORTD
-#define PPM_SIGNAL 4 // Pin 4
-#define LED_STATUS_DDR DDRB
-#define LED_STATUS_PORT PORTB
-#define LED_STATUS 0 // Pin 17 (built-in Rx LED)
-#else
-#error Unsupported board
-#endif
-
 //---------------------------------------------------------------------------
 
+#include "Board.h"
 #include "Timer.h"
+#include "EepromWriter.h"
+#include "EepromJournal.h"
 #include "Receiver.h"
 #include "UsbReports.h"
+#if HIDRCJOY_OSCCAL
+#include "OscillatorCalibration.h"
+#endif
 
 //---------------------------------------------------------------------------
 
 static Timer g_Timer;
+static EepromWriter g_EepromWriter;
 static Receiver g_Receiver;
-static UsbReport g_UsbReport;
+// Input report buffer for all report layouts
+union UsbInputReport
+{
+    uint8_t m_reportId;
+    UsbReport m_axes7;
+    UsbReport4 m_axes4;
+#if defined(USB_V_USB)
+    UsbReport16Part m_axes16;
+#else
+    UsbReport16 m_axes16;
+#endif
+    UsbButtonReport m_buttons;
+};
+
+#if defined(USB_V_USB)
+#define USB_REPORT_MAX_PARTS USB_REPORT16_PARTS
+#else
+#define USB_REPORT_MAX_PARTS 1
+#endif
+
+static UsbInputReport g_UsbReport;
+static ReportLayout g_UsbReportLayout;
+static uint8_t g_UsbReportLayoutId;
+static bool g_UsbReconnectPending;
+static uint32_t g_UsbReconnectTime;
+static uint8_t g_UsbIdleRate;
 static UsbEnhancedReport g_UsbEnhancedReport;
-static Configuration g_EepromConfiguration __attribute__((section(".eeprom")));
+static UsbTimingReport g_UsbTimingReport;
+static bool g_UsbTimingReportPending;
+static UsbDiagnosticsReport g_UsbDiagnosticsReport;
+static UsbDiagnosticsControlReport g_UsbDiagnosticsControl;
+static UsbCalibrationControlReport g_UsbCalibrationControl;
+static UsbEepromStatusReport g_UsbEepromStatusReport;
+// Host writes, which are checked before they are applied, are received here
+static union
+{
+    Configuration m_configuration;
+    UsbConfigurationPatchReport m_patch;
+#if HIDRCJOY_MIXER
+    MixerConfiguration m_mixer;
+#endif
+} g_UsbReceivedReport;
+#if HIDRCJOY_MIXER
+static MixerConfiguration g_EepromMixer __attribute__((section(".eeprom")));
+#define EEPROM_MIXER_SIZE sizeof(MixerConfiguration)
+#else
+#define EEPROM_MIXER_SIZE 0
+#endif
+#if HIDRCJOY_PROFILES > 1
+static ProfileConfiguration g_EepromProfileConfiguration __attribute__((section(".eeprom")));
+#define EEPROM_PROFILE_SIZE sizeof(ProfileConfiguration)
+#else
+#define EEPROM_PROFILE_SIZE 0
+#endif
+
+// The configuration journal takes the rest of the EEPROM, with all profiles in one record
+#define EEPROM_JOURNAL_SLOT_SIZE (sizeof(g_Receiver.m_Profiles) + sizeof(EepromJournal::Trailer))
+#define EEPROM_JOURNAL_SLOTS ((E2END + 1 - EEPROM_MIXER_SIZE - EEPROM_PROFILE_SIZE) / EEPROM_JOURNAL_SLOT_SIZE)
+static_assert(EEPROM_JOURNAL_SLOTS >= 2, "EEPROM too small for the configuration journal");
+static uint8_t g_EepromJournalSlots[EEPROM_JOURNAL_SLOTS][EEPROM_JOURNAL_SLOT_SIZE] __attribute__((section(".eeprom")));
+static EepromJournal g_EepromJournal;
+#if HIDRCJOY_OSCCAL
+static OscillatorCalibration g_OscillatorCalibration;
+#endif
+#if HIDRCJOY_SLEEP
+static volatile bool g_WorkPending;
+#endif
 
 //---------------------------------------------------------------------------
 
-static void PrepareUsbReport()
+static void PrepareAxisReport(uint8_t* values, uint8_t count, bool hasData)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        values[i] = hasData ? g_Receiver.GetValue(i) : 0x80;
+    }
+}
+
+static void PrepareAxis16Report(int16_t* values, uint8_t first, uint8_t count, bool hasData)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t channel = first + i;
+        values[i] = hasData && channel < Configuration::maxChannels ? g_Receiver.GetAxisValue(channel) : 0;
+    }
+}
+
+static void PrepareButtonReport(UsbButtonReport& report, bool hasData)
+{
+    uint8_t axis = 0;
+    uint8_t button = 0;
+
+    report.m_buttons = 0;
+    for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+    {
+        uint8_t positions = g_Receiver.m_Configuration->GetSwitchPositions(i);
+        if (positions == 0)
+        {
+            // Axes beyond the report capacity are dropped
+            if (axis < COUNTOF(report.m_value))
+            {
+                report.m_value[axis++] = hasData ? g_Receiver.GetValue(i) : 0x80;
+            }
+        }
+        else
+        {
+            uint8_t position = hasData ? g_Receiver.GetSwitchPosition(i) : 0;
+            if (positions == 2)
+            {
+                if (position == 1)
+                {
+                    report.m_buttons |= _BV(button);
+                }
+
+                button++;
+            }
+            else
+            {
+                if (position != 1)
+                {
+                    report.m_buttons |= _BV(button + position / 2);
+                }
+
+                button += 2;
+            }
+        }
+    }
+
+    while (axis < COUNTOF(report.m_value))
+    {
+        report.m_value[axis++] = 0x80;
+    }
+}
+
+// Prepares the input report with the given part of the active report layout
+static void PrepareUsbReport(uint8_t part)
 {
     bool hasData = g_Receiver.GetStatus() != NoSignal;
 
-    g_UsbReport.m_reportId = UsbReportId;
-    for (uint8_t i = 0; i < COUNTOF(g_UsbReport.m_value); i++)
+    g_UsbReport.m_reportId = g_UsbReportLayout.m_reportId + part;
+    switch (g_UsbReportLayoutId)
+    {
+    case Axes4Layout:
+        PrepareAxisReport(g_UsbReport.m_axes4.m_value, COUNTOF(g_UsbReport.m_axes4.m_value), hasData);
+        break;
+    case Axes16Layout:
+        PrepareAxis16Report(g_UsbReport.m_axes16.m_value, part * COUNTOF(g_UsbReport.m_axes16.m_value), COUNTOF(g_UsbReport.m_axes16.m_value), hasData);
+        break;
+    case ButtonsLayout:
+        PrepareButtonReport(g_UsbReport.m_buttons, hasData);
+        break;
+    default:
+        PrepareAxisReport(g_UsbReport.m_axes7.m_value, COUNTOF(g_UsbReport.m_axes7.m_value), hasData);
+        break;
+    }
+}
+
+// Returns true if the report ID belongs to the active report layout
+static bool IsUsbReportId(uint8_t reportId)
+{
+    return static_cast<uint8_t>(reportId - g_UsbReportLayout.m_reportId) < g_UsbReportLayout.m_reportParts;
+}
+
+// The report layout is latched here, so the reports always match the descriptor the host enumerated
+static void SetReportLayout(uint8_t layout)
+{
+    g_UsbReportLayoutId = layout < ReportLayoutCount ? layout : Axes7Layout;
+    memcpy_P(&g_UsbReportLayout, &g_ReportLayouts[g_UsbReportLayoutId], sizeof(g_UsbReportLayout));
+    SetUsbReportLayout(g_UsbReportLayoutId);
+}
+
+static uint32_t GetFrameTime()
+{
+#if HIDRCJOY_SRXL
+    if (g_Receiver.GetStatus() == SrxlSignal)
+        return g_Receiver.m_SrxlReceiver.GetFrameTime();
+#endif
+
+    return Timer::TicksToUs(g_Receiver.GetPpmFrameTicks());
+}
+
+static void PrepareUsbTimingReport(uint32_t sendTime)
+{
+    g_UsbTimingReport.m_reportId = UsbTimingReportId;
+    g_UsbTimingReport.m_sequence = g_Receiver.GetUpdateCounter();
+    g_UsbTimingReport.m_frameTime = static_cast<uint16_t>(GetFrameTime());
+    g_UsbTimingReport.m_sendTime = sendTime;
+}
+
+// Prepares the next input report, if a frame was completed or the signal status changed
+// since the last report, if the idle period expired, or on every poll while upsampling.
+// Returns false if there is nothing to send.
+static bool PrepareChangedUsbReport()
+{
+    static uint8_t lastUpdateCounter;
+    static uint8_t lastStatus;
+    static uint8_t pendingParts = 0xFF;
+    static uint8_t idleParts;
+    static uint8_t nextPart;
+    static uint32_t lastReportTime;
+    static UsbInputReport lastReport[USB_REPORT_MAX_PARTS];
+
+    uint8_t parts = g_UsbReportLayout.m_reportParts;
+    uint8_t allParts = _BV(parts) - 1;
+    pendingParts &= allParts;
+
+    uint8_t updateCounter = g_Receiver.GetUpdateCounter();
+    uint8_t status = g_Receiver.GetStatus();
+    if (updateCounter != lastUpdateCounter || status != lastStatus)
+    {
+        lastUpdateCounter = updateCounter;
+        lastStatus = status;
+        pendingParts = allParts;
+    }
+
+#if HIDRCJOY_UPSAMPLING
+    // The extrapolated values change on every poll, the comparison below drops unchanged parts
+    if (g_Receiver.IsUpsampling())
     {
-        g_UsbReport.m_value[i] = hasData ? g_Receiver.GetValue(i) : 0x80;
+#if HIDRCJOY_MIXER
+        g_Receiver.UpdateUpsampledMixer();
+#endif
+        pendingParts = allParts;
+    }
+#endif
+
+    // The idle rate is specified in units of 4 ms, zero means to only send on change
+    uint32_t time = g_Timer.GetMicros();
+    if (g_UsbIdleRate != 0 && time - lastReportTime >= g_UsbIdleRate * 4000UL)
+    {
+        lastReportTime = time;
+        pendingParts = allParts;
+        idleParts = pendingParts;
+    }
+
+    while (pendingParts != 0)
+    {
+        uint8_t part = nextPart;
+        nextPart = part + 1 < parts ? part + 1 : 0;
+
+        if ((pendingParts & _BV(part)) == 0)
+            continue;
+
+        pendingParts &= ~_BV(part);
+
+        PrepareUsbReport(part);
+        if ((idleParts & _BV(part)) != 0 || memcmp(&g_UsbReport, &lastReport[part], g_UsbReportLayout.m_reportSize) != 0)
+        {
+            idleParts &= ~_BV(part);
+            memcpy(&lastReport[part], &g_UsbReport, g_UsbReportLayout.m_reportSize);
+            lastReportTime = time;
+
+            if ((g_Receiver.m_Configuration->m_flags & Configuration::TimingReports) != 0)
+            {
+                PrepareUsbTimingReport(time);
+                g_UsbTimingReportPending = true;
+            }
+
+            return true;
+        }
     }
+
+    return false;
 }
 
 static void PrepareUsbEnhancedReport()
@@ -98,27 +319,231 @@ static void PrepareUsbEnhancedReport()
     }
 }
 
-static void LoadConfigurationDefaults()
+static void PrepareUsbDiagnosticsReport(uint8_t part)
+{
+    g_UsbDiagnosticsReport.m_reportId = UsbDiagnosticsPart1Id + part;
+    g_UsbDiagnosticsReport.m_status = g_Receiver.GetStatus();
+
+    for (uint8_t i = 0; i < COUNTOF(g_UsbDiagnosticsReport.m_channelPulseWidth); i++)
+    {
+        uint8_t channel = part * USB_DIAGNOSTICS_PART_CHANNELS + i;
+        g_UsbDiagnosticsReport.m_channelPulseWidth[i] = g_UsbDiagnosticsReport.m_status != 0 && channel < Configuration::maxChannels ? g_Receiver.GetChannelPulseWidth(channel) : 0;
+    }
+}
+
+// Streams the diagnostics report parts for each new frame or signal status change.
+// Returns false if streaming is disabled or all parts were sent.
+static bool PrepareChangedUsbDiagnosticsReport()
+{
+    static uint8_t lastUpdateCounter;
+    static uint8_t lastStatus;
+    static uint8_t nextPart = USB_DIAGNOSTICS_PARTS;
+
+    if (!g_UsbDiagnosticsControl.m_enable)
+        return false;
+
+    uint8_t updateCounter = g_Receiver.GetUpdateCounter();
+    uint8_t status = g_Receiver.GetStatus();
+    if (updateCounter != lastUpdateCounter || status != lastStatus)
+    {
+        lastUpdateCounter = updateCounter;
+        lastStatus = status;
+        nextPart = 0;
+    }
+
+    if (nextPart >= USB_DIAGNOSTICS_PARTS)
+        return false;
+
+    PrepareUsbDiagnosticsReport(nextPart++);
+    return true;
+}
+
+static void InitializeEepromJournal()
+{
+    g_EepromJournal.Initialize(g_EepromJournalSlots, sizeof(g_Receiver.m_Profiles), EEPROM_JOURNAL_SLOTS);
+}
+
+// Writing the EEPROM takes several ms per byte, so it is done in the background
+// from the main loop, instead of blocking the USB control request
+static void StartEepromWrite()
 {
+    // A write in progress has not completed its slot yet, so it starts over in the same slot
+    bool restart = g_EepromWriter.IsBusy();
+
+    g_EepromWriter.Clear();
+    if (restart)
+    {
+        g_EepromJournal.Rewrite(g_EepromWriter, g_Receiver.m_Profiles);
+    }
+    else
+    {
+        g_EepromJournal.Write(g_EepromWriter, g_Receiver.m_Profiles);
+    }
+
+#if HIDRCJOY_MIXER
+    g_EepromWriter.Add(&g_EepromMixer, &g_Receiver.m_Mixer, sizeof(g_EepromMixer));
+#endif
+#if HIDRCJOY_PROFILES > 1
+    g_EepromWriter.Add(&g_EepromProfileConfiguration, &g_Receiver.m_ProfileConfiguration, sizeof(g_EepromProfileConfiguration));
+#endif
+    g_EepromWriter.Start();
+}
+
+// Upgrades the configuration of a firmware before the journal, which stored it at the start
+// of the EEPROM. The fields that are laid out as before are kept, the others get their defaults.
+static bool ReadLegacyConfigurationFromEeprom()
+{
+    const uint8_t* legacyConfiguration = 0;
+
+    uint8_t size = Configuration::GetCompatibleSize(eeprom_read_byte(legacyConfiguration + offsetof(Configuration, m_version)));
+    if (size == 0)
+        return false;
+
     g_Receiver.LoadDefaultConfiguration();
-    g_Receiver.UpdateConfiguration();
+
+    Configuration& config = g_Receiver.m_Profiles[0];
+    eeprom_read_block(&config, legacyConfiguration, size);
+    config.m_version = Configuration::version;
+
+    // Version 0x11 had an unused byte in place of the report layout, and only the inverted signal flag
+    config.m_reportLayout = Axes7Layout;
+    config.m_flags &= Configuration::InvertedSignal;
+    if (!Receiver::IsValidProfile(config))
+        return false;
+
+    for (uint8_t i = 1; i < HIDRCJOY_PROFILES; i++)
+    {
+        g_Receiver.m_Profiles[i] = config;
+    }
+
+    return true;
 }
 
 static void ReadConfigurationFromEeprom()
 {
-    eeprom_read_block(&g_Receiver.m_Configuration, &g_EepromConfiguration, sizeof(g_EepromConfiguration));
+    bool migrated = false;
+
+    // Reading the journal selects the newest complete slot, so a write in progress is abandoned
+    g_EepromWriter.Clear();
 
-    if (!g_Receiver.IsValidConfiguration())
+    if (g_EepromJournal.Read(g_Receiver.m_Profiles) && g_Receiver.IsValidConfiguration())
+    {
+#if HIDRCJOY_PROFILES > 1
+        eeprom_read_block(&g_Receiver.m_ProfileConfiguration, &g_EepromProfileConfiguration, sizeof(g_EepromProfileConfiguration));
+        g_Receiver.UpdateProfileConfiguration();
+#endif
+    }
+    else if (ReadLegacyConfigurationFromEeprom())
+    {
+        migrated = true;
+    }
+    else
     {
         g_Receiver.LoadDefaultConfiguration();
     }
 
+#if HIDRCJOY_MIXER
+    eeprom_read_block(&g_Receiver.m_Mixer, &g_EepromMixer, sizeof(g_EepromMixer));
+
+    if (!Receiver::IsValidMixer(g_Receiver.m_Mixer))
+    {
+        g_Receiver.LoadDefaultMixer();
+    }
+#endif
+
     g_Receiver.UpdateConfiguration();
+
+    // Moves the upgraded configuration into the journal, so it is only migrated once
+    if (migrated)
+    {
+        StartEepromWrite();
+    }
 }
 
 static void WriteConfigurationToEeprom()
 {
-    eeprom_write_block(&g_Receiver.m_Configuration, &g_EepromConfiguration, sizeof(g_EepromConfiguration));
+    StartEepromWrite();
+
+    // A new report layout requires the host to enumerate the device again
+    if (g_Receiver.GetReportLayout() != g_UsbReportLayoutId)
+    {
+        g_UsbReconnectPending = true;
+        g_UsbReconnectTime = g_Timer.GetMicros();
+    }
+}
+
+// A configuration changed while it is written is stored partly old and partly new, so write its slot again
+static void RestartEepromWrite()
+{
+    if (g_EepromWriter.IsBusy())
+    {
+        StartEepromWrite();
+    }
+}
+
+static void LoadConfigurationDefaults()
+{
+    g_Receiver.LoadDefaultConfiguration();
+#if HIDRCJOY_MIXER
+    g_Receiver.LoadDefaultMixer();
+#endif
+    g_Receiver.UpdateConfiguration();
+    RestartEepromWrite();
+}
+
+static void PrepareUsbEepromStatusReport()
+{
+    g_UsbEepromStatusReport.m_reportId = EepromStatusId;
+    g_UsbEepromStatusReport.m_busy = g_EepromWriter.IsBusy();
+    g_UsbEepromStatusReport.m_bytesRemaining = g_EepromWriter.GetBytesRemaining();
+}
+
+// A patch is applied as soon as it is received, so reading the report returns an empty patch
+static void PrepareUsbConfigurationPatchReport()
+{
+    memset(&g_UsbReceivedReport.m_patch, 0, sizeof(g_UsbReceivedReport.m_patch));
+    g_UsbReceivedReport.m_patch.m_reportId = ConfigurationPatchId;
+}
+
+static void SetConfiguration()
+{
+    if (g_Receiver.SetConfiguration(g_UsbReceivedReport.m_configuration))
+    {
+        RestartEepromWrite();
+    }
+}
+
+static void PatchConfiguration()
+{
+    const UsbConfigurationPatchReport& patch = g_UsbReceivedReport.m_patch;
+    if (g_Receiver.PatchConfiguration(patch.m_offset, patch.m_length, patch.m_data))
+    {
+        RestartEepromWrite();
+    }
+}
+
+#if HIDRCJOY_MIXER
+static void SetMixer()
+{
+    if (g_Receiver.SetMixer(g_UsbReceivedReport.m_mixer))
+    {
+        RestartEepromWrite();
+    }
+}
+#endif
+
+static void UpdateCalibration()
+{
+    if (g_UsbCalibrationControl.m_learn)
+    {
+        g_Receiver.StartCalibration();
+    }
+    else
+    {
+        g_Receiver.FinishCalibration();
+    }
+
+    RestartEepromWrite();
 }
 
 static void JumpToBootloader()
@@ -132,12 +557,14 @@ static void JumpToBootloader()
 #if defined(USB_V_USB)
 
 static uint8_t g_UsbWriteReportId;
+static uint8_t* g_UsbWriteBuffer;
 static uint8_t g_UsbWritePosition;
 static uint8_t g_UsbWriteBytesRemaining;
 
-static void SetupUsbWrite(uint8_t reportId, uint8_t transferSize)
+static void SetupUsbWrite(uint8_t reportId, void* buffer, uint8_t transferSize)
 {
     g_UsbWriteReportId = reportId;
+    g_UsbWriteBuffer = static_cast<uint8_t*>(buffer);
     g_UsbWritePosition = 0;
     g_UsbWriteBytesRemaining = transferSize;
 }
@@ -150,13 +577,37 @@ extern "C" uchar usbFunctionWrite(uchar* data, uchar length)
     if (length > g_UsbWriteBytesRemaining)
         length = g_UsbWriteBytesRemaining;
 
-    memcpy(reinterpret_cast<uint8_t*>(&g_Receiver.m_Configuration) + g_UsbWritePosition, data, length);
+    memcpy(g_UsbWriteBuffer + g_UsbWritePosition, data, length);
     g_UsbWritePosition += length;
     g_UsbWriteBytesRemaining -= length;
 
     if (g_UsbWriteBytesRemaining == 0)
     {
-        g_Receiver.UpdateConfiguration();
+        if (g_UsbWriteReportId == ConfigurationReportId)
+        {
+            SetConfiguration();
+        }
+        else if (g_UsbWriteReportId == ConfigurationPatchId)
+        {
+            PatchConfiguration();
+        }
+        else if (g_UsbWriteReportId == CalibrationControlId)
+        {
+            UpdateCalibration();
+        }
+#if HIDRCJOY_MIXER
+        else if (g_UsbWriteReportId == MixerReportId)
+        {
+            SetMixer();
+        }
+#endif
+#if HIDRCJOY_PROFILES > 1
+        else if (g_UsbWriteReportId == ProfileReportId)
+        {
+            g_Receiver.UpdateProfileConfiguration();
+            RestartEepromWrite();
+        }
+#endif
     }
 
     return g_UsbWriteBytesRemaining == 0; // return 1 if this was the last chunk
@@ -164,7 +615,6 @@ extern "C" uchar usbFunctionWrite(uchar* data, uchar length)
 
 extern "C" usbMsgLen_t usbFunctionSetup(uchar data[8])
 {
-    static uint8_t idleRate;
     const usbRequest_t* request = (const usbRequest_t*)data;
 
     if ((request->bmRequestType & USBRQ_TYPE_MASK) == USBRQ_TYPE_CLASS)
@@ -172,20 +622,55 @@ extern "C" usbMsgLen_t usbFunctionSetup(uchar data[8])
         if (request->bRequest == USBRQ_HID_GET_REPORT)
         {
             uint8_t reportId = request->wValue.bytes[0];
-            switch (reportId)
+            if (IsUsbReportId(reportId))
             {
-            case UsbReportId:
-                PrepareUsbReport();
+                PrepareUsbReport(reportId - g_UsbReportLayout.m_reportId);
                 usbMsgPtr = (usbMsgPtr_t)&g_UsbReport;
-                return sizeof(g_UsbReport);
+                return g_UsbReportLayout.m_reportSize;
+            }
+
+            switch (reportId)
+            {
             case UsbEnhancedReportId:
                 PrepareUsbEnhancedReport();
                 usbMsgPtr = (usbMsgPtr_t)&g_UsbEnhancedReport;
                 return sizeof(g_UsbEnhancedReport);
+            case UsbTimingReportId:
+                PrepareUsbTimingReport(g_Timer.GetMicros());
+                usbMsgPtr = (usbMsgPtr_t)&g_UsbTimingReport;
+                return sizeof(g_UsbTimingReport);
             case ConfigurationReportId:
-                g_Receiver.m_Configuration.m_reportId = ConfigurationReportId;
-                usbMsgPtr = (usbMsgPtr_t)&g_Receiver.m_Configuration;
-                return sizeof(g_Receiver.m_Configuration);
+                g_Receiver.m_Configuration->m_reportId = ConfigurationReportId;
+                usbMsgPtr = (usbMsgPtr_t)g_Receiver.m_Configuration;
+                return sizeof(Configuration);
+            case EepromStatusId:
+                PrepareUsbEepromStatusReport();
+                usbMsgPtr = (usbMsgPtr_t)&g_UsbEepromStatusReport;
+                return sizeof(g_UsbEepromStatusReport);
+            case DiagnosticsControlId:
+                g_UsbDiagnosticsControl.m_reportId = DiagnosticsControlId;
+                usbMsgPtr = (usbMsgPtr_t)&g_UsbDiagnosticsControl;
+                return sizeof(g_UsbDiagnosticsControl);
+            case CalibrationControlId:
+                g_UsbCalibrationControl.m_reportId = CalibrationControlId;
+                usbMsgPtr = (usbMsgPtr_t)&g_UsbCalibrationControl;
+                return sizeof(g_UsbCalibrationControl);
+            case ConfigurationPatchId:
+                PrepareUsbConfigurationPatchReport();
+                usbMsgPtr = (usbMsgPtr_t)&g_UsbReceivedReport.m_patch;
+                return sizeof(g_UsbReceivedReport.m_patch);
+#if HIDRCJOY_MIXER
+            case MixerReportId:
+                g_Receiver.m_Mixer.m_reportId = MixerReportId;
+                usbMsgPtr = (usbMsgPtr_t)&g_Receiver.m_Mixer;
+                return sizeof(g_Receiver.m_Mixer);
+#endif
+#if HIDRCJOY_PROFILES > 1
+            case ProfileReportId:
+                g_Receiver.m_ProfileConfiguration.m_reportId = ProfileReportId;
+                usbMsgPtr = (usbMsgPtr_t)&g_Receiver.m_ProfileConfiguration;
+                return sizeof(g_Receiver.m_ProfileConfiguration);
+#endif
             default:
                 return 0;
             }
@@ -196,8 +681,27 @@ extern "C" usbMsgLen_t usbFunctionSetup(uchar data[8])
             switch (reportId)
             {
             case ConfigurationReportId:
-                SetupUsbWrite(reportId, sizeof(g_Receiver.m_Configuration));
+                SetupUsbWrite(reportId, &g_UsbReceivedReport.m_configuration, sizeof(g_UsbReceivedReport.m_configuration));
+                return USB_NO_MSG;
+            case DiagnosticsControlId:
+                SetupUsbWrite(reportId, &g_UsbDiagnosticsControl, sizeof(g_UsbDiagnosticsControl));
+                return USB_NO_MSG;
+            case ConfigurationPatchId:
+                SetupUsbWrite(reportId, &g_UsbReceivedReport.m_patch, sizeof(g_UsbReceivedReport.m_patch));
                 return USB_NO_MSG;
+            case CalibrationControlId:
+                SetupUsbWrite(reportId, &g_UsbCalibrationControl, sizeof(g_UsbCalibrationControl));
+                return USB_NO_MSG;
+#if HIDRCJOY_MIXER
+            case MixerReportId:
+                SetupUsbWrite(reportId, &g_UsbReceivedReport.m_mixer, sizeof(g_UsbReceivedReport.m_mixer));
+                return USB_NO_MSG;
+#endif
+#if HIDRCJOY_PROFILES > 1
+            case ProfileReportId:
+                SetupUsbWrite(reportId, &g_Receiver.m_ProfileConfiguration, sizeof(g_Receiver.m_ProfileConfiguration));
+                return USB_NO_MSG;
+#endif
             case LoadConfigurationDefaultsId:
                 LoadConfigurationDefaults();
                 return 0;
@@ -216,21 +720,31 @@ extern "C" usbMsgLen_t usbFunctionSetup(uchar data[8])
         }
         else if (request->bRequest == USBRQ_HID_GET_IDLE)
         {
-            usbMsgPtr = (usbMsgPtr_t)&idleRate;
+            usbMsgPtr = (usbMsgPtr_t)&g_UsbIdleRate;
             return 1;
         }
         else if (request->bRequest == USBRQ_HID_SET_IDLE)
         {
-            idleRate = request->wValue.bytes[1];
+            g_UsbIdleRate = request->wValue.bytes[1];
         }
     }
 
     return 0;
 }
 
-static void InitializeUsb(void)
+#if HIDRCJOY_OSCCAL
+extern "C" void usbEventResetReady(void)
+{
+    cli();
+    g_OscillatorCalibration.Calibrate();
+    sei();
+
+    g_Receiver.m_PpmReceiver.SetClockCorrection(g_OscillatorCalibration.GetCorrection());
+}
+#endif
+
+static void ReconnectUsb(void)
 {
-    usbInit();
     usbDeviceDisconnect();
 
     for (int i = 0; i < 256; i++)
@@ -242,14 +756,31 @@ static void InitializeUsb(void)
     usbDeviceConnect();
 }
 
+static void InitializeUsb(void)
+{
+    usbInit();
+    ReconnectUsb();
+}
+
 static void ProcessUsb(void)
 {
     usbPoll();
 
     if (usbInterruptIsReady())
     {
-        PrepareUsbReport();
-        usbSetInterrupt((uchar*)&g_UsbReport, sizeof(g_UsbReport));
+        if (PrepareChangedUsbReport())
+        {
+            usbSetInterrupt((uchar*)&g_UsbReport, g_UsbReportLayout.m_reportSize);
+        }
+        else if (g_UsbTimingReportPending)
+        {
+            g_UsbTimingReportPending = false;
+            usbSetInterrupt((uchar*)&g_UsbTimingReport, sizeof(g_UsbTimingReport));
+        }
+        else if (PrepareChangedUsbDiagnosticsReport())
+        {
+            usbSetInterrupt((uchar*)&g_UsbDiagnosticsReport, sizeof(g_UsbDiagnosticsReport));
+        }
     }
 }
 
@@ -266,29 +797,95 @@ void EVENT_USB_Device_ControlRequest(void)
         if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
         {
             uint8_t reportId = (USB_ControlRequest.wValue & 0xFF);
-            switch (reportId)
+            if (IsUsbReportId(reportId))
             {
-            case UsbReportId:
-                PrepareUsbReport();
+                PrepareUsbReport(reportId - g_UsbReportLayout.m_reportId);
                 Endpoint_ClearSETUP();
-                Endpoint_Write_Control_Stream_LE(&g_UsbReport, sizeof(g_UsbReport));
+                Endpoint_Write_Control_Stream_LE(&g_UsbReport, g_UsbReportLayout.m_reportSize);
                 Endpoint_ClearOUT();
                 break;
+            }
+
+            switch (reportId)
+            {
             case UsbEnhancedReportId:
                 PrepareUsbEnhancedReport();
                 Endpoint_ClearSETUP();
                 Endpoint_Write_Control_Stream_LE(&g_UsbEnhancedReport, sizeof(g_UsbEnhancedReport));
                 Endpoint_ClearOUT();
                 break;
+            case UsbTimingReportId:
+                PrepareUsbTimingReport(g_Timer.GetMicros());
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_UsbTimingReport, sizeof(g_UsbTimingReport));
+                Endpoint_ClearOUT();
+                break;
             case ConfigurationReportId:
-                g_Receiver.m_Configuration.m_reportId = ConfigurationReportId;
+                g_Receiver.m_Configuration->m_reportId = ConfigurationReportId;
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(g_Receiver.m_Configuration, sizeof(Configuration));
+                Endpoint_ClearOUT();
+                break;
+            case EepromStatusId:
+                PrepareUsbEepromStatusReport();
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_UsbEepromStatusReport, sizeof(g_UsbEepromStatusReport));
+                Endpoint_ClearOUT();
+                break;
+            case DiagnosticsControlId:
+                g_UsbDiagnosticsControl.m_reportId = DiagnosticsControlId;
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_UsbDiagnosticsControl, sizeof(g_UsbDiagnosticsControl));
+                Endpoint_ClearOUT();
+                break;
+            case CalibrationControlId:
+                g_UsbCalibrationControl.m_reportId = CalibrationControlId;
                 Endpoint_ClearSETUP();
-                Endpoint_Write_Control_Stream_LE(&g_Receiver.m_Configuration, sizeof(g_Receiver.m_Configuration));
+                Endpoint_Write_Control_Stream_LE(&g_UsbCalibrationControl, sizeof(g_UsbCalibrationControl));
                 Endpoint_ClearOUT();
                 break;
+            case ConfigurationPatchId:
+                PrepareUsbConfigurationPatchReport();
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_UsbReceivedReport.m_patch, sizeof(g_UsbReceivedReport.m_patch));
+                Endpoint_ClearOUT();
+                break;
+#if HIDRCJOY_MIXER
+            case MixerReportId:
+                g_Receiver.m_Mixer.m_reportId = MixerReportId;
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_Receiver.m_Mixer, sizeof(g_Receiver.m_Mixer));
+                Endpoint_ClearOUT();
+                break;
+#endif
+#if HIDRCJOY_PROFILES > 1
+            case ProfileReportId:
+                g_Receiver.m_ProfileConfiguration.m_reportId = ProfileReportId;
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&g_Receiver.m_ProfileConfiguration, sizeof(g_Receiver.m_ProfileConfiguration));
+                Endpoint_ClearOUT();
+                break;
+#endif
             }
         }
         break;
+    case HID_REQ_GetIdle:
+        if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE) && USB_ControlRequest.wIndex == INTERFACE_ID_Joystick)
+        {
+            Endpoint_ClearSETUP();
+            Endpoint_Write_8(g_UsbIdleRate);
+            Endpoint_ClearIN();
+            Endpoint_ClearStatusStage();
+        }
+        break;
+    case HID_REQ_SetIdle:
+        if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE) && USB_ControlRequest.wIndex == INTERFACE_ID_Joystick)
+        {
+            Endpoint_ClearSETUP();
+            Endpoint_ClearStatusStage();
+            g_UsbIdleRate = (USB_ControlRequest.wValue >> 8);
+        }
+        break;
     case HID_REQ_SetReport:
         if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
         {
@@ -297,9 +894,44 @@ void EVENT_USB_Device_ControlRequest(void)
             {
             case ConfigurationReportId:
                 Endpoint_ClearSETUP();
-                Endpoint_Read_Control_Stream_LE(&g_Receiver.m_Configuration, sizeof(g_Receiver.m_Configuration));
+                Endpoint_Read_Control_Stream_LE(&g_UsbReceivedReport.m_configuration, sizeof(g_UsbReceivedReport.m_configuration));
+                Endpoint_ClearIN();
+                SetConfiguration();
+                break;
+            case DiagnosticsControlId:
+                Endpoint_ClearSETUP();
+                Endpoint_Read_Control_Stream_LE(&g_UsbDiagnosticsControl, sizeof(g_UsbDiagnosticsControl));
+                Endpoint_ClearIN();
+                break;
+            case ConfigurationPatchId:
+                Endpoint_ClearSETUP();
+                Endpoint_Read_Control_Stream_LE(&g_UsbReceivedReport.m_patch, sizeof(g_UsbReceivedReport.m_patch));
                 Endpoint_ClearIN();
+                PatchConfiguration();
                 break;
+            case CalibrationControlId:
+                Endpoint_ClearSETUP();
+                Endpoint_Read_Control_Stream_LE(&g_UsbCalibrationControl, sizeof(g_UsbCalibrationControl));
+                Endpoint_ClearIN();
+                UpdateCalibration();
+                break;
+#if HIDRCJOY_MIXER
+            case MixerReportId:
+                Endpoint_ClearSETUP();
+                Endpoint_Read_Control_Stream_LE(&g_UsbReceivedReport.m_mixer, sizeof(g_UsbReceivedReport.m_mixer));
+                Endpoint_ClearIN();
+                SetMixer();
+                break;
+#endif
+#if HIDRCJOY_PROFILES > 1
+            case ProfileReportId:
+                Endpoint_ClearSETUP();
+                Endpoint_Read_Control_Stream_LE(&g_Receiver.m_ProfileConfiguration, sizeof(g_Receiver.m_ProfileConfiguration));
+                Endpoint_ClearIN();
+                g_Receiver.UpdateProfileConfiguration();
+                RestartEepromWrite();
+                break;
+#endif
             case LoadConfigurationDefaultsId:
                 Endpoint_ClearSETUP();
                 Endpoint_Read_Control_Stream_LE(&reportId, sizeof(reportId));
@@ -330,9 +962,36 @@ void EVENT_USB_Device_ControlRequest(void)
     }
 }
 
+#if HIDRCJOY_SLEEP
+// The start of frame interrupt wakes the main loop once per ms, also during enumeration
+void EVENT_USB_Device_Reset(void)
+{
+    USB_Device_EnableSOFEvents();
+}
+
+void EVENT_USB_Device_StartOfFrame(void)
+{
+    g_WorkPending = true;
+}
+#endif
+
 void EVENT_USB_Device_ConfigurationChanged(void)
 {
     Endpoint_ConfigureEndpoint(JOYSTICK_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
+    Endpoint_ConfigureEndpoint(VENDOR_EPADDR, EP_TYPE_INTERRUPT, VENDOR_EPSIZE, 1);
+}
+
+static void ReconnectUsb(void)
+{
+    USB_Detach();
+
+    for (int i = 0; i < 256; i++)
+    {
+        wdt_reset();
+        _delay_ms(1);
+    }
+
+    USB_Attach();
 }
 
 static void InitializeUsb(void)
@@ -350,28 +1009,72 @@ static void ProcessUsb(void)
 
         if (Endpoint_IsINReady())
         {
-            PrepareUsbReport();
-            Endpoint_Write_Stream_LE(&g_UsbReport, sizeof(g_UsbReport), NULL);
-            Endpoint_ClearIN();
+            if (PrepareChangedUsbReport())
+            {
+                Endpoint_Write_Stream_LE(&g_UsbReport, g_UsbReportLayout.m_reportSize, NULL);
+                Endpoint_ClearIN();
+            }
+        }
+
+        Endpoint_SelectEndpoint(VENDOR_EPADDR);
+
+        if (Endpoint_IsINReady())
+        {
+            if (g_UsbTimingReportPending)
+            {
+                g_UsbTimingReportPending = false;
+                Endpoint_Write_Stream_LE(&g_UsbTimingReport, sizeof(g_UsbTimingReport), NULL);
+                Endpoint_ClearIN();
+            }
+            else if (PrepareChangedUsbDiagnosticsReport())
+            {
+                Endpoint_Write_Stream_LE(&g_UsbDiagnosticsReport, sizeof(g_UsbDiagnosticsReport), NULL);
+                Endpoint_ClearIN();
+            }
         }
     }
 }
 
 #endif
 
+// Re-enumerates the device with the report layout of the current configuration
+static void ProcessUsbReconnect(uint32_t time)
+{
+    // Give the host time to complete the pending control transfer, and finish the EEPROM write
+    const uint32_t reconnectDelay = 50000;
+
+    if (g_UsbReconnectPending && time - g_UsbReconnectTime >= reconnectDelay && !g_EepromWriter.IsBusy())
+    {
+        g_UsbReconnectPending = false;
+        SetReportLayout(g_Receiver.GetReportLayout());
+        ReconnectUsb();
+    }
+}
+
 //---------------------------------------------------------------------------
 
 static void InitializePorts(void)
 {
-    // LED_STATUS is output
-    LED_STATUS_DDR = _BV(LED_STATUS);
+    // LED status pin is output
+    Board::LedStatusDdr() = _BV(Board::ledStatus);
 
-    // Pull-up on PPM_SIGNAL
-    PPM_SIGNAL_PORT = _BV(PPM_SIGNAL);
+    // Pull-up on PPM signal pin
+    Board::PpmSignalPort() = _BV(Board::ppmSignal);
 }
 
 //---------------------------------------------------------------------------
 
+#if HIDRCJOY_TIMER1
+ISR(TIMER1_OVF_vect)
+{
+    g_Timer.Overflow();
+
+#if HIDRCJOY_SLEEP
+    // Keeps the status LED and the signal timeouts going while USB is suspended
+    g_WorkPending = true;
+#endif
+}
+#else
 #ifndef TIMER0_OVF_vect
 #define TIMER0_OVF_vect TIM0_OVF_vect
 #endif
@@ -380,10 +1083,11 @@ ISR(TIMER0_OVF_vect)
 {
     g_Timer.Overflow();
 }
+#endif
 
 //---------------------------------------------------------------------------
 
-#if defined (__AVR_ATtiny85__)
+#if !HIDRCJOY_TIMER1
 static void InitializeUsi(void)
 {
     USISR = 0x0F;
@@ -395,7 +1099,7 @@ static void InitializeUsi(void)
 ISR(USI_OVF_vect)
 {
     uint16_t ticks = g_Timer.GetTicksNoCli();
-    bool level = (PPM_SIGNAL_PIN & _BV(PPM_SIGNAL)) != 0;
+    bool level = (Board::PpmSignalPin() & _BV(Board::ppmSignal)) != 0;
 
     // Clear counter overflow flag
     USISR = _BV(USIOIF) | 0x0F;
@@ -405,11 +1109,11 @@ ISR(USI_OVF_vect)
 }
 #endif
 
-#if defined (__AVR_ATtiny44__) || defined (__AVR_ATtiny167__) || defined (__AVR_ATmega32U4__)
+#if HIDRCJOY_TIMER1
 static void InitializeInputCapture(void)
 {
-#if defined (BOARD_FabISP)
-    // On the FabISP board, the ICP pin is tied up for USB, so use the ADC comparator with ADC6 instead
+#if HIDRCJOY_CAPTURE_COMPARATOR
+    // The ICP pin is tied up for USB, so use the ADC comparator with ADC6 instead
 
     // Analog comparator bandgap select, analog comparator input capture enable
     ACSR = _BV(ACBG) | _BV(ACIC);
@@ -423,22 +1127,31 @@ static void InitializeInputCapture(void)
     // ADC6
     ADMUX = _BV(MUX2) | _BV(MUX1);
 
-    // Noise canceler, input capture rising edge, clk/8
-    TCCR1B = _BV(ICNC1) | _BV(CS11);
+    // Noise canceler, input capture rising edge, timer1 clock is set up by Timer
+    TCCR1B |= _BV(ICNC1);
 #else
-    // Noise canceler, input capture rising edge, clk/8
-    TCCR1B = _BV(ICNC1) | _BV(ICES1) | _BV(CS11);
+    // Noise canceler, input capture rising edge, timer1 clock is set up by Timer
+    TCCR1B |= _BV(ICNC1) | _BV(ICES1);
 #endif
 
     // Input capture interrupt enable
-    TIMSK1 = _BV(ICIE1);
+    TIMSK1 |= _BV(ICIE1);
 }
 
 ISR(TIMER1_CAPT_vect)
 {
     uint16_t ticks = ICR1;
     sei();
+#if HIDRCJOY_SLEEP
+    uint8_t updateCounter = g_Receiver.m_PpmReceiver.GetUpdateCounter();
     g_Receiver.m_PpmReceiver.OnPinChanged(true, ticks);
+    if (g_Receiver.m_PpmReceiver.GetUpdateCounter() != updateCounter)
+    {
+        g_WorkPending = true;
+    }
+#else
+    g_Receiver.m_PpmReceiver.OnPinChanged(true, ticks);
+#endif
 }
 #endif
 
@@ -446,12 +1159,42 @@ ISR(TIMER1_CAPT_vect)
 ISR(USART1_RX_vect)
 {
     uint32_t time = g_Timer.GetMicros();
+#if HIDRCJOY_SLEEP
+    uint8_t updateCounter = g_Receiver.m_SrxlReceiver.GetUpdateCounter();
     g_Receiver.m_SrxlReceiver.OnDataReceived(time);
+    if (g_Receiver.m_SrxlReceiver.GetUpdateCounter() != updateCounter)
+    {
+        g_WorkPending = true;
+    }
+#else
+    g_Receiver.m_SrxlReceiver.OnDataReceived(time);
+#endif
 }
 #endif
 
 //---------------------------------------------------------------------------
 
+#if HIDRCJOY_SLEEP
+// Idles the CPU until an interrupt signals work: a USB frame, a received PPM or SRXL frame,
+// or a timer overflow. Interrupts are only enabled right before sleeping, and the instruction
+// after sei is always executed, so a signal cannot be missed between the check and the sleep.
+static void WaitForWork()
+{
+    cli();
+    while (!g_WorkPending)
+    {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+    }
+
+    g_WorkPending = false;
+    sei();
+}
+#endif
+
 static void BlinkStatusLed(bool good, uint32_t time)
 {
     static uint32_t lastTime;
@@ -462,12 +1205,12 @@ static void BlinkStatusLed(bool good, uint32_t time)
         if (time - lastTime > period)
         {
             lastTime = time;
-            LED_STATUS_PORT ^= _BV(LED_STATUS);
+            Board::LedStatusPort() ^= _BV(Board::ledStatus);
         }
     }
     else
     {
-        LED_STATUS_PORT &= ~_BV(LED_STATUS);
+        Board::LedStatusPort() &= ~_BV(Board::ledStatus);
     }
 }
 
@@ -480,25 +1223,37 @@ int main(void)
     InitializePorts();
     g_Timer.Initialize();
     g_Receiver.Initialize();
-#if defined (__AVR_ATtiny85__)
-    InitializeUsi();
-#elif defined (__AVR_ATtiny44__) || defined (__AVR_ATtiny167__) || defined (__AVR_ATmega32U4__)
+#if HIDRCJOY_TIMER1
     InitializeInputCapture();
 #else
-#error Unsupported MCU
+    InitializeUsi();
 #endif
 
     InitializeUsb();
+    InitializeEepromJournal();
     ReadConfigurationFromEeprom();
+    SetReportLayout(g_Receiver.GetReportLayout());
+#if HIDRCJOY_SLEEP
+    set_sleep_mode(SLEEP_MODE_IDLE);
+#endif
     sei();
 
     for (;;)
     {
+#if HIDRCJOY_SLEEP
+        WaitForWork();
+#endif
         wdt_reset();
         ProcessUsb();
+        g_EepromWriter.Update();
 
-        uint32_t time = g_Timer.GetMicros();
-        g_Receiver.Update(time);
+        uint32_t ticks = g_Timer.GetTicks();
+        uint32_t time = Timer::TicksToUs(ticks);
+        ProcessUsbReconnect(time);
+        if (g_Receiver.Update(time, ticks))
+        {
+            RestartEepromWrite();
+        }
         BlinkStatusLed(g_Receiver.GetStatus() != NoSignal, time);
     }
 
@@ -10,6 +10,8 @@
 #ifndef __usbconfig_h_included__
 #define __usbconfig_h_included__
 
+#include "Board.h"
+
 /*
 General Description:
 This file is an example configuration (with inline documentation) for the USB
@@ -40,21 +42,7 @@ section at the end of this file).
  * markers every millisecond.]
  */
 
-#if defined (__AVR_ATtiny85__)
-#define USB_CFG_IOPORTNAME      B
-#define USB_CFG_DMINUS_BIT      3
-#define USB_CFG_DPLUS_BIT       4
-#elif defined (__AVR_ATtiny167__)
-#define USB_CFG_IOPORTNAME      B
-#define USB_CFG_DMINUS_BIT      3
-#define USB_CFG_DPLUS_BIT       6
-#elif defined (__AVR_ATtiny44__)
-#define USB_CFG_IOPORTNAME      A
-#define USB_CFG_DMINUS_BIT      0
-#define USB_CFG_DPLUS_BIT       7
-#else
-#error Unsupported device
-#endif
+/* The USB lines of each board are defined in Board.h */
 
 #define USB_CFG_CLOCK_KHZ       (F_CPU/1000)
 /* Clock rate of the AVR in kHz. Legal values are 12000, 12800, 15000, 16000,
@@ -123,7 +111,7 @@ section at the end of this file).
  * (e.g. HID), but never want to send any data. This option saves a couple
  * of bytes in flash memory and the transmit buffers in RAM.
  */
-#define USB_CFG_INTR_POLL_INTERVAL      20
+#define USB_CFG_INTR_POLL_INTERVAL      10
 /* If you compile a version with endpoint 1 (interrupt-in), this is the poll
  * interval. The value is in milliseconds and must not be less than 10 ms for
  * low speed devices.
@@ -142,7 +130,7 @@ section at the end of this file).
  * transfers. Set it to 0 if you don't need it and want to save a couple of
  * bytes.
  */
-#define USB_CFG_IMPLEMENT_FN_READ       0
+#define USB_CFG_IMPLEMENT_FN_READ       1
 /* Set this to 1 if you need to send control replies which are generated
  * "on the fly" when usbFunctionRead() is called. If you only want to send
  * data from a static buffer, set it to 0 and return the data from
@@ -181,6 +169,15 @@ section at the end of this file).
  * one parameter which distinguishes between the start of RESET state and its
  * end.
  */
+#if HIDRCJOY_OSCCAL
+#ifndef __ASSEMBLER__
+extern void usbEventResetReady(void);
+#endif
+#define USB_RESET_HOOK(resetStarts)     if(!resetStarts){usbEventResetReady();}
+#endif
+/* Boards running from the internal RC oscillator calibrate it against the
+ * USB frame length at the end of every USB reset.
+ */
 /* #define USB_SET_ADDRESS_HOOK()              hadAddressAssigned(); */
 /* This macro (if defined) is executed when a USB SET_ADDRESS request was
  * received.
@@ -301,7 +298,7 @@ section at the end of this file).
  * HID class is 3, no subclass and protocol required (but may be useful!)
  * CDC class is 2, use subclass 2 and protocol 1 for ACM
  */
-#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    112
+#define USB_CFG_HID_REPORT_DESCRIPTOR_LENGTH    0 /* depends on the report layout, see Descriptors.c */
 /* Define this to the length of the HID report descriptor, if you implement
  * an HID device. Otherwise don't define it or define it to 0.
  * If you use this define, you must add a PROGMEM character array named
@@ -367,14 +364,14 @@ section at the end of this file).
  */
 
 #define USB_CFG_DESCR_PROPS_DEVICE                  0
-#define USB_CFG_DESCR_PROPS_CONFIGURATION           0
+#define USB_CFG_DESCR_PROPS_CONFIGURATION           USB_PROP_IS_DYNAMIC
 #define USB_CFG_DESCR_PROPS_STRINGS                 0
 #define USB_CFG_DESCR_PROPS_STRING_0                0
 #define USB_CFG_DESCR_PROPS_STRING_VENDOR           0
 #define USB_CFG_DESCR_PROPS_STRING_PRODUCT          0
 #define USB_CFG_DESCR_PROPS_STRING_SERIAL_NUMBER    0
-#define USB_CFG_DESCR_PROPS_HID                     0
-#define USB_CFG_DESCR_PROPS_HID_REPORT              0
+#define USB_CFG_DESCR_PROPS_HID                     USB_PROP_IS_DYNAMIC
+#define USB_CFG_DESCR_PROPS_HID_REPORT              USB_PROP_IS_DYNAMIC
 #define USB_CFG_DESCR_PROPS_UNKNOWN                 0
 
 
@@ -394,24 +391,6 @@ section at the end of this file).
  * which is not fully supported (such as IAR C) or if you use a differnt
  * interrupt than INT0, you may have to define some of these.
  */
-#if defined (__AVR_ATtiny85__)
-#define USB_INTR_CFG            PCMSK
-#define USB_INTR_CFG_SET        (1 << USB_CFG_DPLUS_BIT)
-#define USB_INTR_CFG_CLR        0
-#define USB_INTR_ENABLE         GIMSK
-#define USB_INTR_ENABLE_BIT     PCIE
-#define USB_INTR_PENDING        GIFR
-#define USB_INTR_PENDING_BIT    PCIF
-#define USB_INTR_VECTOR         PCINT0_vect
-#elif defined (__AVR_ATtiny167__)
-#define USB_INTR_CFG            PCMSK1
-#define USB_INTR_CFG_SET        (1 << USB_CFG_DPLUS_BIT)
-#define USB_INTR_CFG_CLR        0
-#define USB_INTR_ENABLE         PCICR
-#define USB_INTR_ENABLE_BIT     PCIE1
-#define USB_INTR_PENDING        PCIFR
-#define USB_INTR_PENDING_BIT    PCIF1
-#define USB_INTR_VECTOR         PCINT1_vect
-#endif
+/* Boards with D+ on a pin change interrupt define these in Board.h */
 
 #endif /* __usbconfig_h_included__ */
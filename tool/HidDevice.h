@@ -12,6 +12,8 @@ class HidDevice
 {
     static const uint16_t m_vendorID = 0x16C0;
     static const uint16_t m_productID = 0x03E8;
+    static const USAGE m_vendorUsagePage = 0xFF00;
+    static const USAGE m_vendorUsage = 0x01;
 
 public:
     ~HidDevice()
@@ -37,13 +39,46 @@ public:
         if (FAILED(hr))
             return hr;
 
-        HidD_SetNumInputBuffers(m_hDevice, 2);
+        HidD_SetNumInputBuffers(m_hDevice, 64);
+
+        // Input reports are read asynchronously through a second handle
+        HANDLE hReadDevice = CreateFile(pszDevicePath, GENERIC_READ, dwShareMode, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+        if (hReadDevice == INVALID_HANDLE_VALUE)
+            return AtlHresultFromLastError();
+
+        m_hReadDevice = hReadDevice;
+
+        m_overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        if (m_overlapped.hEvent == nullptr)
+            return AtlHresultFromLastError();
+
+        m_readBuffer.allocate(m_caps.InputReportByteLength);
 
         return S_OK;
     }
 
     void Close()
     {
+        if (m_hReadDevice != nullptr)
+        {
+            if (m_readPending)
+            {
+                DWORD dwBytesRead = 0;
+                CancelIo(m_hReadDevice);
+                GetOverlappedResult(m_hReadDevice, &m_overlapped, &dwBytesRead, TRUE);
+                m_readPending = false;
+            }
+
+            CloseHandle(m_hReadDevice);
+            m_hReadDevice = nullptr;
+        }
+
+        if (m_overlapped.hEvent != nullptr)
+        {
+            CloseHandle(m_overlapped.hEvent);
+            m_overlapped.hEvent = nullptr;
+        }
+
         if (m_preparsedData != nullptr)
         {
             HidD_FreePreparsedData(m_preparsedData);
@@ -71,6 +106,44 @@ public:
         return buffer;
     }
 
+    // Returns the next input report from the interrupt pipe, or an empty buffer on timeout
+    Buffer<uint8_t> Read(DWORD dwTimeout)
+    {
+        if (!m_readPending)
+        {
+            ResetEvent(m_overlapped.hEvent);
+            if (!ReadFile(m_hReadDevice, m_readBuffer.data(), static_cast<DWORD>(m_readBuffer.size()), nullptr, &m_overlapped))
+            {
+                if (GetLastError() != ERROR_IO_PENDING)
+                    throw std::runtime_error("ReadFile failed");
+            }
+
+            m_readPending = true;
+        }
+
+        if (WaitForSingleObject(m_overlapped.hEvent, dwTimeout) != WAIT_OBJECT_0)
+            return Buffer<uint8_t>();
+
+        m_readPending = false;
+
+        DWORD dwBytesRead = 0;
+        if (!GetOverlappedResult(m_hReadDevice, &m_overlapped, &dwBytesRead, FALSE))
+            throw std::runtime_error("ReadFile failed");
+
+        return Buffer<uint8_t>(m_readBuffer.data(), dwBytesRead);
+    }
+
+    Buffer<uint8_t> GetInputReport(uint8_t index)
+    {
+        Buffer<uint8_t> buffer(m_caps.InputReportByteLength);
+
+        buffer[0] = index;
+        if (!HidD_GetInputReport(m_hDevice, buffer.data(), m_caps.InputReportByteLength))
+            throw std::runtime_error("HidD_GetInputReport failed");
+
+        return buffer;
+    }
+
     Buffer<uint8_t> GetFeatureReport(uint8_t index)
     {
         Buffer<uint8_t> buffer(m_caps.FeatureReportByteLength);
@@ -136,7 +209,13 @@ private:
         if (attributes.VendorID != m_vendorID || attributes.ProductID != m_productID)
             return AtlHresultFromWin32(ERROR_INVALID_DATA);
 
-        if (m_caps.UsagePage != HID_USAGE_PAGE_GENERIC || m_caps.Usage != HID_USAGE_GENERIC_JOYSTICK)
+        // V-USB devices have a single joystick interface, LUFA devices a separate vendor interface for configuration
+        bool isJoystick = m_caps.UsagePage == HID_USAGE_PAGE_GENERIC && m_caps.Usage == HID_USAGE_GENERIC_JOYSTICK;
+        bool isVendor = m_caps.UsagePage == m_vendorUsagePage && m_caps.Usage == m_vendorUsage;
+        if (!isJoystick && !isVendor)
+            return AtlHresultFromWin32(ERROR_INVALID_DATA);
+
+        if (m_caps.FeatureReportByteLength == 0)
             return AtlHresultFromWin32(ERROR_INVALID_DATA);
 
         return S_OK;
@@ -144,6 +223,10 @@ private:
 
 protected:
     HANDLE m_hDevice = nullptr;
+    HANDLE m_hReadDevice = nullptr;
+    OVERLAPPED m_overlapped = {};
+    Buffer<uint8_t> m_readBuffer;
+    bool m_readPending = false;
     PHIDP_PREPARSED_DATA m_preparsedData = nullptr;
     HIDP_CAPS m_caps = {};
     std::wstring m_product;
@@ -15,10 +15,12 @@ class HidRcJoyDevice : public HidDevice
 public:
     Configuration* GetConfiguration() { return &m_configuration; }
 
+    // The device only sends input reports on change, so return the values of the last ones
     void ReadReport(UsbReport& report)
     {
-        auto buffer = Read();
-        std::memcpy(&report, buffer.data(), sizeof(report));
+        ReadInputReports();
+        report = m_report;
+        report.m_reportId = UsbReportId;
     }
 
     void ReadEnhancedReport(UsbEnhancedReport& report)
@@ -27,10 +29,38 @@ public:
         std::memcpy(&report, buffer.data(), sizeof(report));
     }
 
+    void EnableDiagnostics(bool enable)
+    {
+        uint8_t data[] = { DiagnosticsControlId, static_cast<uint8_t>(enable ? 1 : 0) };
+        SetFeatureReport(DiagnosticsControlId, Buffer<uint8_t>(data, sizeof(data)));
+    }
+
+    // Returns true if any diagnostics reports were received since the last call
+    bool ReadDiagnostics(UsbEnhancedReport& report)
+    {
+        ReadInputReports();
+
+        bool received = m_diagnosticsReceived;
+        m_diagnosticsReceived = false;
+        report = m_enhancedReport;
+        report.m_reportId = UsbEnhancedReportId;
+        return received;
+    }
+
+    // Starts recording the channel endpoints, or stops and applies the calibration
+    void LearnCalibration(bool learn)
+    {
+        uint8_t data[] = { CalibrationControlId, static_cast<uint8_t>(learn ? 1 : 0) };
+        SetFeatureReport(CalibrationControlId, Buffer<uint8_t>(data, sizeof(data)));
+    }
+
+    // Boards without curves, filters or SRXL send a shorter configuration, which lacks those fields
     void ReadConfiguration()
     {
         auto buffer = GetFeatureReport(ConfigurationReportId);
-        std::memcpy(&m_configuration, buffer.data(), sizeof(m_configuration));
+        size_t size = buffer.size() < sizeof(m_configuration) ? buffer.size() : sizeof(m_configuration);
+        m_configuration = {};
+        std::memcpy(&m_configuration, buffer.data(), size);
     }
 
     void WriteConfiguration()
@@ -39,6 +69,59 @@ public:
         SetFeatureReport(ConfigurationReportId, buffer);
     }
 
+    // Sends a field of the configuration returned by GetConfiguration, instead of the whole
+    // configuration. The device checks each patch on its own, so fields should not exceed
+    // USB_CONFIGURATION_PATCH_SIZE.
+    void WriteConfigurationField(const void* field, size_t size)
+    {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(&m_configuration);
+        size_t offset = static_cast<const uint8_t*>(field) - base;
+
+        while (size > 0)
+        {
+            size_t length = size < USB_CONFIGURATION_PATCH_SIZE ? size : USB_CONFIGURATION_PATCH_SIZE;
+
+            UsbConfigurationPatchReport report = {};
+            report.m_reportId = ConfigurationPatchId;
+            report.m_offset = static_cast<uint8_t>(offset);
+            report.m_length = static_cast<uint8_t>(length);
+            std::memcpy(report.m_data, base + offset, length);
+            SetFeatureReport(ConfigurationPatchId, Buffer<uint8_t>(reinterpret_cast<const uint8_t*>(&report), sizeof(report)));
+
+            offset += length;
+            size -= length;
+        }
+    }
+
+    // Only available on boards with HIDRCJOY_MIXER
+    void ReadMixer(MixerConfiguration& mixer)
+    {
+        auto buffer = GetFeatureReport(MixerReportId);
+        CheckReportSize(buffer, sizeof(mixer));
+        std::memcpy(&mixer, buffer.data(), sizeof(mixer));
+    }
+
+    void WriteMixer(const MixerConfiguration& mixer)
+    {
+        Buffer<uint8_t> buffer(reinterpret_cast<const uint8_t*>(&mixer), sizeof(mixer));
+        SetFeatureReport(MixerReportId, buffer);
+    }
+
+    // Only available on boards with more than one profile. The configuration
+    // report reads and writes the active profile.
+    void ReadProfileConfiguration(ProfileConfiguration& profiles)
+    {
+        auto buffer = GetFeatureReport(ProfileReportId);
+        CheckReportSize(buffer, sizeof(profiles));
+        std::memcpy(&profiles, buffer.data(), sizeof(profiles));
+    }
+
+    void WriteProfileConfiguration(const ProfileConfiguration& profiles)
+    {
+        Buffer<uint8_t> buffer(reinterpret_cast<const uint8_t*>(&profiles), sizeof(profiles));
+        SetFeatureReport(ProfileReportId, buffer);
+    }
+
     void LoadDefaultConfiguration()
     {
         SetFeatureReport(LoadConfigurationDefaultsId, Buffer<uint8_t>());
@@ -54,13 +137,148 @@ public:
         SetFeatureReport(WriteConfigurationToEepromId, Buffer<uint8_t>());
     }
 
+    // The device writes the EEPROM in the background after WriteConfigurationToEeprom
+    bool IsEepromBusy()
+    {
+        UsbEepromStatusReport report = {};
+        auto buffer = GetFeatureReport(EepromStatusId);
+        CheckReportSize(buffer, sizeof(report));
+        std::memcpy(&report, buffer.data(), sizeof(report));
+        return report.m_busy != 0;
+    }
+
     void JumpToBootloader()
     {
         SetFeatureReport(JumpToBootloaderId, Buffer<uint8_t>());
     }
 
+private:
+    // Drains the interrupt pipe, which carries the joystick and the diagnostics reports
+    void ReadInputReports()
+    {
+        while (true)
+        {
+            auto buffer = Read(0);
+            if (buffer.size() == 0)
+                break;
+
+            switch (buffer[0])
+            {
+            case UsbDiagnosticsPart1Id:
+            case UsbDiagnosticsPart2Id:
+            case UsbDiagnosticsPart3Id:
+            {
+                UsbDiagnosticsReport part = {};
+                CheckReportSize(buffer, sizeof(part));
+                std::memcpy(&part, buffer.data(), sizeof(part));
+                int channel = (part.m_reportId - UsbDiagnosticsPart1Id) * USB_DIAGNOSTICS_PART_CHANNELS;
+                for (int i = 0; i < USB_DIAGNOSTICS_PART_CHANNELS && channel + i < Configuration::maxChannels; i++)
+                {
+                    m_enhancedReport.m_channelPulseWidth[channel + i] = part.m_channelPulseWidth[i];
+                }
+
+                m_enhancedReport.m_status = part.m_status;
+                m_diagnosticsReceived = true;
+                break;
+            }
+            default:
+                ParseReport(buffer);
+                break;
+            }
+        }
+    }
+
+    void ParseReport(const Buffer<uint8_t>& buffer)
+    {
+        switch (buffer[0])
+        {
+        case UsbReportId:
+            CheckReportSize(buffer, sizeof(m_report));
+            std::memcpy(&m_report, buffer.data(), sizeof(m_report));
+            break;
+        case UsbReport4Id:
+        {
+            // Channels beyond the first four are not reported
+            UsbReport4 report4 = {};
+            CheckReportSize(buffer, sizeof(report4));
+            std::memcpy(&report4, buffer.data(), sizeof(report4));
+            for (int i = 0; i < Configuration::maxChannels; i++)
+            {
+                m_report.m_value[i] = i < static_cast<int>(_countof(report4.m_value)) ? report4.m_value[i] : 0x80;
+            }
+            break;
+        }
+        case UsbReport16Id:
+        {
+            UsbReport16 report16 = {};
+            CheckReportSize(buffer, sizeof(report16));
+            std::memcpy(&report16, buffer.data(), sizeof(report16));
+            for (int i = 0; i < Configuration::maxChannels; i++)
+            {
+                m_report.m_value[i] = ValueFromAxisValue(report16.m_value[i]);
+            }
+            break;
+        }
+        case UsbReport16Part1Id:
+        case UsbReport16Part2Id:
+        case UsbReport16Part3Id:
+        {
+            UsbReport16Part part = {};
+            CheckReportSize(buffer, sizeof(part));
+            std::memcpy(&part, buffer.data(), sizeof(part));
+            int channel = (part.m_reportId - UsbReport16Part1Id) * USB_REPORT16_PART_CHANNELS;
+            for (int i = 0; i < USB_REPORT16_PART_CHANNELS && channel + i < Configuration::maxChannels; i++)
+            {
+                m_report.m_value[channel + i] = ValueFromAxisValue(part.m_value[i]);
+            }
+            break;
+        }
+        case UsbButtonReportId:
+        {
+            // Switch channels are shown at their end or center positions
+            UsbButtonReport buttonReport = {};
+            CheckReportSize(buffer, sizeof(buttonReport));
+            std::memcpy(&buttonReport, buffer.data(), sizeof(buttonReport));
+            int axis = 0;
+            int button = 0;
+            for (uint8_t i = 0; i < Configuration::maxChannels; i++)
+            {
+                switch (m_configuration.GetSwitchPositions(i))
+                {
+                case 2:
+                    m_report.m_value[i] = (buttonReport.m_buttons & (1 << button)) != 0 ? 0xFF : 0x00;
+                    button++;
+                    break;
+                case 3:
+                    m_report.m_value[i] = (buttonReport.m_buttons & (1 << button)) != 0 ? 0x00 : (buttonReport.m_buttons & (1 << (button + 1))) != 0 ? 0xFF : 0x80;
+                    button += 2;
+                    break;
+                default:
+                    m_report.m_value[i] = axis < USB_BUTTON_REPORT_AXES ? buttonReport.m_value[axis++] : 0x80;
+                    break;
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    static void CheckReportSize(const Buffer<uint8_t>& buffer, size_t size)
+    {
+        if (buffer.size() < size)
+            throw std::runtime_error("Report too small");
+    }
+
+    static uint8_t ValueFromAxisValue(int16_t value)
+    {
+        return static_cast<uint8_t>(0x80 + (value >> 8));
+    }
+
 private:
     Configuration m_configuration;
+    UsbReport m_report = {};
+    UsbEnhancedReport m_enhancedReport = {};
+    bool m_diagnosticsReceived = false;
 };
 
 //---------------------------------------------------------------------------
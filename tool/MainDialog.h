@@ -199,11 +199,9 @@ public:
                 m_pDevice->ReadReport(report);
                 UpdateReportControls(report);
 
-                static int count;
-                if (++count % 10 == 0)
+                UsbEnhancedReport enhancedReport = {};
+                if (m_pDevice->ReadDiagnostics(enhancedReport))
                 {
-                    UsbEnhancedReport enhancedReport = {};
-                    m_pDevice->ReadEnhancedReport(enhancedReport);
                     UpdateEnhancedReportControls(enhancedReport);
                 }
             }
@@ -231,13 +229,28 @@ public:
     {
         if (m_pDevice != nullptr && !m_noConfigurationUpdate)
         {
+            // Only send the field that changed, the device ignores values that are not valid yet while typing
             auto pConfiguration = m_pDevice->GetConfiguration();
-            pConfiguration->m_minSyncPulseWidth = static_cast<uint16_t>(GetIntegerValue(m_ecMinSyncPulseWidth));
-            pConfiguration->m_centerChannelPulseWidth = static_cast<uint16_t>(GetIntegerValue(m_ecCenterChannelPulseWidth));
-            pConfiguration->m_channelPulseWidthRange = static_cast<uint16_t>(GetIntegerValue(m_ecChannelPulseWidthRange));
-            pConfiguration->m_flags = static_cast<uint8_t>(m_btInvertedSignal.GetCheck() == BST_CHECKED ? Configuration::InvertedSignal : 0);
-
-            UpdateDeviceConfiguration();
+            switch (wID)
+            {
+            case IDC_MIN_SYNC_PULSE_WIDTH:
+                pConfiguration->m_minSyncPulseWidth = static_cast<uint16_t>(GetIntegerValue(m_ecMinSyncPulseWidth));
+                UpdateDeviceConfiguration(pConfiguration->m_minSyncPulseWidth);
+                break;
+            case IDC_CENTER_CHANNEL_PULSE_WIDTH:
+                pConfiguration->m_centerChannelPulseWidth = static_cast<uint16_t>(GetIntegerValue(m_ecCenterChannelPulseWidth));
+                UpdateDeviceConfiguration(pConfiguration->m_centerChannelPulseWidth);
+                break;
+            case IDC_CHANNEL_PULSE_WIDTH_RANGE:
+                pConfiguration->m_channelPulseWidthRange = static_cast<uint16_t>(GetIntegerValue(m_ecChannelPulseWidthRange));
+                UpdateDeviceConfiguration(pConfiguration->m_channelPulseWidthRange);
+                break;
+            case IDC_INVERTED_SIGNAL:
+                pConfiguration->m_flags = static_cast<uint8_t>((pConfiguration->m_flags & ~Configuration::InvertedSignal) |
+                    (m_btInvertedSignal.GetCheck() == BST_CHECKED ? Configuration::InvertedSignal : 0));
+                UpdateDeviceConfiguration(pConfiguration->m_flags);
+                break;
+            }
         }
 
         return 0;
@@ -252,7 +265,7 @@ public:
             auto pConfiguration = m_pDevice->GetConfiguration();
             pConfiguration->m_polarity ^= 1 << channel;
 
-            UpdateDeviceConfiguration();
+            UpdateDeviceConfiguration(pConfiguration->m_polarity);
             UpdatePolarityButtons(pConfiguration);
         }
 
@@ -269,7 +282,7 @@ public:
             auto pConfiguration = m_pDevice->GetConfiguration();
             pConfiguration->m_mapping[channel] = static_cast<uint8_t>(source);
 
-            UpdateDeviceConfiguration();
+            UpdateDeviceConfiguration(pConfiguration->m_mapping[channel]);
             UpdateAssignmentButtons(pConfiguration);
         }
 
@@ -336,6 +349,17 @@ public:
 
     LRESULT OnClose(WORD wNotifyCode, WORD wID, HWND hWndCtl, BOOL& bHandled)
     {
+        if (m_pDevice != nullptr)
+        {
+            try
+            {
+                m_pDevice->EnableDiagnostics(false);
+            }
+            catch (std::exception&)
+            {
+            }
+        }
+
         EndDialog(wID);
         return 0;
     }
@@ -379,13 +403,14 @@ private:
         return S_OK;
     }
 
-    void UpdateDeviceConfiguration()
+    template<typename T>
+    void UpdateDeviceConfiguration(const T& field)
     {
         if (m_pDevice != nullptr)
         {
             try
             {
-                m_pDevice->WriteConfiguration();
+                m_pDevice->WriteConfigurationField(&field, sizeof(field));
             }
             catch (std::exception&)
             {
@@ -433,6 +458,7 @@ private:
             try
             {
                 m_pDevice->ReadConfiguration();
+                m_pDevice->EnableDiagnostics(true);
 
                 auto pConfiguration = m_pDevice->GetConfiguration();
 